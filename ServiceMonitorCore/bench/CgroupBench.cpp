@@ -0,0 +1,196 @@
+// cgroup collector driver. With no argument it builds a fake cgroup v2 tree of slices,
+// units and delegated sub-cgroups in a temporary directory and checks what
+// CgroupServiceCollector reports: which units, their memory and process counts, CPU
+// from usage_usec deltas, uptime from cgroup.procs, and that a unit which disappears
+// starts over from no baseline. It then times Collect() over a tree of 300 units.
+// Exits with 1 if a check fails.
+// With a cgroup root (e.g. /sys/fs/cgroup) it collects twice a second apart and prints
+// every unit, as a monitor loop on that host would see them.
+// Build with -DSMC_BUILD_BENCHMARKS=ON (Linux) and run: CgroupBench [cgroup root]
+
+#include "CgroupServiceCollector.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace smc;
+namespace fs = std::filesystem;
+
+namespace {
+
+int g_failures = 0;
+
+void Check(bool ok, const char* what)
+{
+    if (!ok) {
+        ++g_failures;
+        std::printf("FAIL %s\n", what);
+    }
+}
+
+void WriteFile(const fs::path& path, const std::string& contents)
+{
+    std::ofstream(path, std::ios::trunc) << contents;
+}
+
+/// A cgroup directory with the files the collector reads. An empty `memoryBytes` leaves
+/// memory.current out, as when the memory controller is not enabled.
+void MakeCgroup(const fs::path& path, uint64_t usageUs, const std::string& memoryBytes, uint64_t pids,
+                const std::string& procs)
+{
+    fs::create_directories(path);
+    WriteFile(path / "cpu.stat", "usage_usec " + std::to_string(usageUs) + "\nuser_usec 0\nsystem_usec 0\n");
+    if (!memoryBytes.empty())
+        WriteFile(path / "memory.current", memoryBytes + "\n");
+    WriteFile(path / "pids.current", std::to_string(pids) + "\n");
+    WriteFile(path / "cgroup.procs", procs);
+}
+
+void SetUsage(const fs::path& path, uint64_t usageUs)
+{
+    WriteFile(path / "cpu.stat", "usage_usec " + std::to_string(usageUs) + "\nuser_usec 0\nsystem_usec 0\n");
+}
+
+const UnitMetrics* Find(const std::vector<UnitMetrics>& units, const wchar_t* name)
+{
+    for (const auto& unit : units) {
+        if (unit.name == name)
+            return &unit;
+    }
+    return nullptr;
+}
+
+void RunChecks(const fs::path& root)
+{
+    long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t processors = cpus > 0 ? static_cast<uint64_t>(cpus) : 1;
+    std::string self = std::to_string(::getpid()) + "\n";
+
+    // system.slice/a.service: plain unit holding this process
+    // system.slice/b.service: no memory controller, processes only in a delegated child
+    // user.slice/user-1000.slice/user@1000.service: nested slices; its sub-cgroups,
+    //   even one named like a unit, belong to it
+    // init.scope: not a unit
+    fs::path a = root / "system.slice" / "a.service";
+    fs::path b = root / "system.slice" / "b.service";
+    fs::path user = root / "user.slice" / "user-1000.slice" / "user@1000.service";
+    MakeCgroup(a, 1'000'000, "52428800", 3, self);
+    MakeCgroup(b, 0, "", 2, "");
+    MakeCgroup(b / "worker", 0, "", 0, "1\n");
+    MakeCgroup(user, 0, "1048576", 5, "");
+    MakeCgroup(user / "app.slice" / "inner.service", 0, "1048576", 1, self);
+    MakeCgroup(root / "init.scope", 0, "1048576", 1, "1\n");
+
+    CgroupServiceCollector collector(root.string());
+    std::vector<UnitMetrics> units;
+    Check(collector.Collect(units), "Collect() reads the root");
+    Check(units.size() == 3, "three units: a, b and user@1000");
+    const UnitMetrics* unitA = Find(units, L"a.service");
+    const UnitMetrics* unitB = Find(units, L"b.service");
+    Check(unitA && unitB && Find(units, L"user@1000.service"), "units are found in nested slices");
+    Check(!Find(units, L"inner.service"), "a unit's sub-cgroups are not units");
+    if (!unitA || !unitB)
+        return;
+    Check(unitA->metrics.memoryMB == 50.0, "memory.current in MB");
+    Check(unitB->metrics.memoryMB == 0.0, "no memory.current reads as 0");
+    Check(unitA->processCount == 3 && unitB->processCount == 2, "pids.current");
+    Check(unitA->metrics.cpuPercent == 0.0, "a unit's first sample reports 0 % CPU");
+    Check(unitB->metrics.uptimeSeconds > 0, "uptime from a process in a delegated child (pid 1)");
+    Check(unitB->metrics.uptimeSeconds >= unitA->metrics.uptimeSeconds, "pid 1 is older than this process");
+    Check(unitA->metrics.status == L"Running", "units report Running");
+
+    // Half of every CPU for at least 200 ms: a little under 50 %, as the interval runs long
+    auto sleep = std::chrono::milliseconds(200);
+    SetUsage(a, 1'000'000 + 100'000 * processors);
+    std::this_thread::sleep_for(sleep);
+    Check(collector.Collect(units), "second Collect()");
+    unitA = Find(units, L"a.service");
+    Check(unitA && unitA->metrics.cpuPercent > 40.0 && unitA->metrics.cpuPercent <= 50.0,
+          "CPU from the usage_usec delta over the interval, as a share of all CPUs");
+
+    // A counter that went backwards (unit restarted between samples) reads as idle
+    SetUsage(a, 0);
+    Check(collector.Collect(units), "third Collect()");
+    unitA = Find(units, L"a.service");
+    Check(unitA && unitA->metrics.cpuPercent == 0.0, "a usage_usec reset reports 0 %");
+
+    // A unit that is gone is dropped with its baseline: when it comes back, its first
+    // sample reports 0 rather than a delta against the old counter
+    fs::remove_all(a);
+    Check(collector.Collect(units), "Collect() after a unit stopped");
+    Check(units.size() == 2 && !Find(units, L"a.service"), "a stopped unit is no longer reported");
+    MakeCgroup(a, 5'000'000, "52428800", 1, self);
+    Check(collector.Collect(units), "Collect() after the unit restarted");
+    unitA = Find(units, L"a.service");
+    Check(unitA && unitA->metrics.cpuPercent == 0.0, "a restarted unit starts without a baseline");
+}
+
+void RunTiming(const fs::path& root)
+{
+    constexpr int Units = 300;
+    constexpr int Rounds = 100;
+    for (int u = 0; u < Units; ++u) {
+        fs::path unit = root / "system.slice" / ("unit" + std::to_string(u) + ".service");
+        MakeCgroup(unit, static_cast<uint64_t>(u) * 1000, "10485760", 2, "");
+    }
+
+    CgroupServiceCollector collector(root.string());
+    std::vector<UnitMetrics> units;
+    collector.Collect(units);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < Rounds; ++r)
+        collector.Collect(units);
+    auto t1 = std::chrono::steady_clock::now();
+    std::printf("Collect() over %zu units: %.1f us per call\n", units.size(),
+                std::chrono::duration<double, std::micro>(t1 - t0).count() / Rounds);
+}
+
+int PrintHost(const std::string& root)
+{
+    CgroupServiceCollector collector(root);
+    std::vector<UnitMetrics> units;
+    if (!collector.Collect(units)) {
+        std::printf("cannot read %s\n", root.c_str());
+        return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    collector.Collect(units);
+    std::printf("%-48s %8s %10s %6s %10s\n", "unit", "cpu %", "memory MB", "pids", "uptime s");
+    for (const auto& unit : units) {
+        std::printf("%-48s %8.2f %10.1f %6llu %10llu\n", fs::path(unit.name).string().c_str(),
+                    unit.metrics.cpuPercent, unit.metrics.memoryMB,
+                    static_cast<unsigned long long>(unit.processCount),
+                    static_cast<unsigned long long>(unit.metrics.uptimeSeconds));
+    }
+    return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    if (argc > 1)
+        return PrintHost(argv[1]);
+
+    std::string pattern = (fs::temp_directory_path() / "SmcCgroupBench.XXXXXX").string();
+    if (!::mkdtemp(pattern.data())) {
+        std::printf("cannot create a temporary directory\n");
+        return 1;
+    }
+    fs::path root = pattern;
+    RunChecks(root / "checks");
+    RunTiming(root / "timing");
+    fs::remove_all(root);
+
+    std::printf(g_failures == 0 ? "all checks passed\n" : "%d checks failed\n", g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+// History storage benchmark: bytes per sample and encode/decode throughput of the
+// pre-ring deque<ServiceDataPoint> layout and HistoryRing, then the deployed 8-column
+// rollup tiers fed 30 days of samples, in bytes per bucket and per service, and last
+// the memory of a whole ServiceHistory against the 50 MB target for 300 services.
+// Exits with 1 if the heap part is over ServiceHistory::HeapBudgetBytes or the target.
+// Build with -DSMC_BUILD_BENCHMARKS=ON and run: HistoryBench [samples] [series] [rollup series]
+
+#include "HistoryRing.h"
+#include "ServiceHistory.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+using namespace smc;
+
+namespace {
+
+size_t g_allocatedBytes = 0;
+size_t g_heapBytes = 0;
+
+/// Allocator that tracks live bytes, so deque block overhead is counted.
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+    CountingAllocator() = default;
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+    T* allocate(size_t n) { g_allocatedBytes += n * sizeof(T); return std::allocator<T>().allocate(n); }
+    void deallocate(T* p, size_t n) { g_allocatedBytes -= n * sizeof(T); std::allocator<T>().deallocate(p, n); }
+    template <typename U>
+    bool operator==(const CountingAllocator<U>&) const { return true; }
+};
+
+/// The per-sample layout used before HistoryRing.
+struct ServiceDataPoint {
+    int64_t timestampMs = 0;
+    double cpuPercent = 0.0;
+    double memoryMB = 0.0;
+};
+
+struct Sample {
+    int64_t timestampMs;
+    double cpu;
+    double memory;
+};
+
+/// Sample source for one service, one sample a second with a little jitter.
+/// Idle: mostly 0 % CPU with occasional bursts and a slowly drifting working set.
+/// Noisy: CPU busy every second and memory moving on most samples.
+class SampleSource {
+public:
+    enum class Profile { Idle, Noisy };
+
+    SampleSource(Profile profile, uint32_t seed)
+        : profile_(profile)
+        , rng_(seed)
+    {
+        memory_ = 20.0 + 200.0 * unit_(rng_);
+    }
+
+    Sample Next()
+    {
+        t_ += 1000 + jitter_(rng_);
+        double cpu = 0.0;
+        if (profile_ == Profile::Idle) {
+            cpu = unit_(rng_) < 0.1 ? std::round(unit_(rng_) * 4000.0) / 100.0 : 0.0;
+            if (unit_(rng_) < 0.05)
+                memory_ += (unit_(rng_) - 0.5) * 2.0;
+        }
+        else {
+            cpu = std::round((20.0 + unit_(rng_) * 60.0) * 100.0) / 100.0;
+            if (unit_(rng_) < 0.5)
+                memory_ = std::max(1.0, memory_ + (unit_(rng_) - 0.5) * 8.0);
+        }
+        return { t_, cpu, static_cast<float>(memory_) };
+    }
+
+private:
+    Profile profile_;
+    std::mt19937 rng_;
+    std::uniform_int_distribution<int> jitter_{ -3, 3 };
+    std::uniform_real_distribution<double> unit_{ 0.0, 1.0 };
+    int64_t t_ = 1'700'000'000'000LL;
+    double memory_ = 0.0;
+};
+
+std::vector<Sample> MakeSeries(size_t count, uint32_t seed)
+{
+    SampleSource source(SampleSource::Profile::Idle, seed);
+    std::vector<Sample> samples(count);
+    for (auto& sample : samples)
+        sample = source.Next();
+    return samples;
+}
+
+double Seconds(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+void Report(const char* name, size_t bytes, size_t samples, double encodeSec, double decodeSec, double checksum)
+{
+    std::printf("%-18s %8.2f B/sample %10.1f M samples/s encode %10.1f M samples/s decode  (checksum %.1f)\n",
+                name, static_cast<double>(bytes) / static_cast<double>(samples),
+                samples / encodeSec / 1e6, samples / decodeSec / 1e6, checksum);
+}
+
+} // anonymous namespace
+
+// Live heap bytes, for the budget check: each block carries its size in front
+void* operator new(size_t n)
+{
+    auto* block = static_cast<size_t*>(std::malloc(n + alignof(std::max_align_t)));
+    if (!block)
+        throw std::bad_alloc();
+    *block = n;
+    g_heapBytes += n;
+    return reinterpret_cast<char*>(block) + alignof(std::max_align_t);
+}
+
+void operator delete(void* p) noexcept
+{
+    if (!p)
+        return;
+    auto* block = reinterpret_cast<size_t*>(static_cast<char*>(p) - alignof(std::max_align_t));
+    g_heapBytes -= *block;
+    std::free(block);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+int main(int argc, char** argv)
+{
+    size_t samplesPerSeries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 7200;
+    size_t seriesCount = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 300;
+    size_t total = samplesPerSeries * seriesCount;
+
+    std::vector<std::vector<Sample>> input;
+    for (size_t s = 0; s < seriesCount; ++s)
+        input.push_back(MakeSeries(samplesPerSeries, static_cast<uint32_t>(s + 1)));
+
+    std::printf("%zu series x %zu samples\n", seriesCount, samplesPerSeries);
+
+    {
+        using Deque = std::deque<ServiceDataPoint, CountingAllocator<ServiceDataPoint>>;
+        std::vector<Deque> store(seriesCount);
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t s = 0; s < seriesCount; ++s)
+            for (const auto& x : input[s])
+                store[s].push_back({ x.timestampMs, x.cpu, x.memory });
+        auto t1 = std::chrono::steady_clock::now();
+        double checksum = 0.0;
+        for (const auto& dq : store)
+            for (const auto& dp : dq)
+                checksum += dp.cpuPercent + dp.memoryMB;
+        auto t2 = std::chrono::steady_clock::now();
+        Report("deque<DataPoint>", g_allocatedBytes, total, Seconds(t1 - t0), Seconds(t2 - t1), checksum);
+    }
+
+    {
+        std::deque<HistoryRing> store;     // rings are not movable
+        for (size_t s = 0; s < seriesCount; ++s)
+            store.emplace_back(samplesPerSeries);
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t s = 0; s < seriesCount; ++s)
+            for (const auto& x : input[s])
+                store[s].Push(x.timestampMs, x.cpu, x.memory);
+        auto t1 = std::chrono::steady_clock::now();
+        double checksum = 0.0;
+        for (const auto& ring : store)
+            ring.ForEach([&](int64_t, double cpu, double memory) { checksum += cpu + memory; });
+        auto t2 = std::chrono::steady_clock::now();
+        size_t bytes = store.size() * samplesPerSeries * HistoryRing::SampleBytes;
+        Report("HistoryRing", bytes, total, Seconds(t1 - t0), Seconds(t2 - t1), checksum);
+    }
+
+    // The rollup tiers as ServiceHistory deploys them, after 30 days of samples
+    size_t rollupSeries = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 4;
+    constexpr size_t MonthSamples = 30ULL * 24 * 3600;
+    for (auto profile : { SampleSource::Profile::Idle, SampleSource::Profile::Noisy }) {
+        const char* name = profile == SampleSource::Profile::Idle ? "idle" : "noisy";
+        std::deque<RollupTier> tenSeconds;
+        std::deque<RollupTier> oneMinute;
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t s = 0; s < rollupSeries; ++s) {
+            auto& fine = tenSeconds.emplace_back(ServiceHistory::TenSecondsMs, ServiceHistory::TenSecondBlocks);
+            auto& coarse = oneMinute.emplace_back(ServiceHistory::OneMinuteMs, ServiceHistory::OneMinuteBlocks);
+            SampleSource source(profile, static_cast<uint32_t>(s + 1));
+            for (size_t i = 0; i < MonthSamples; ++i) {
+                auto x = source.Next();
+                fine.Add(x.timestampMs, x.cpu, x.memory);
+                coarse.Add(x.timestampMs, x.cpu, x.memory);
+            }
+        }
+        auto t1 = std::chrono::steady_clock::now();
+
+        auto report = [&](const char* tier, const std::deque<RollupTier>& tiers) {
+            size_t encoded = 0;
+            size_t buckets = 0;
+            double checksum = 0.0;
+            auto d0 = std::chrono::steady_clock::now();
+            for (const auto& t : tiers) {
+                encoded += t.Sealed().EncodedBytes();
+                t.ForEach([&](const RollupPoint& p) { checksum += p.cpuAvg + p.memoryAvg; ++buckets; });
+            }
+            auto d1 = std::chrono::steady_clock::now();
+            double hours = static_cast<double>(buckets) / static_cast<double>(tiers.size())
+                * static_cast<double>(tiers.front().WidthMs()) / 3'600'000.0;
+            std::printf("%-5s %-4s tier %8.2f B/bucket %8.1f h retained in %5zu KiB %8.1f M buckets/s decode\n",
+                        name, tier, static_cast<double>(encoded) / static_cast<double>(buckets), hours,
+                        tiers.front().MemoryBytes() / 1024, buckets / Seconds(d1 - d0) / 1e6);
+            return checksum;
+        };
+        double checksum = report("10s", tenSeconds) + report("1min", oneMinute);
+        std::printf("%-5s fold+seal %.1f M samples/s into both tiers  (checksum %.1f)\n", name,
+                    static_cast<double>(rollupSeries * MonthSamples) / Seconds(t1 - t0) / 1e6, checksum);
+    }
+
+    // Whole services after 3 hours, so the raw ring and the sketch windows are full.
+    // Owned storage is on the heap here; what is left beyond it stays on the heap with
+    // a history file too
+    constexpr size_t TargetServices = 300;
+    constexpr double TargetMB = 50.0;
+    constexpr size_t WarmSamples = 3 * 3600;
+    bool withinBudget = true;
+    for (auto profile : { SampleSource::Profile::Idle, SampleSource::Profile::Noisy }) {
+        const char* name = profile == SampleSource::Profile::Idle ? "idle" : "noisy";
+        size_t before = g_heapBytes;
+        std::deque<ServiceHistory> services;
+        for (size_t s = 0; s < rollupSeries; ++s) {
+            auto& history = services.emplace_back();
+            SampleSource source(profile, static_cast<uint32_t>(s + 1));
+            for (size_t i = 0; i < WarmSamples; ++i) {
+                auto x = source.Next();
+                history.Push(x.timestampMs, x.cpu, x.memory);
+            }
+        }
+        size_t heap = (g_heapBytes - before) / rollupSeries - ServiceHistory::StorageBytes;
+        double heapMB = static_cast<double>(heap * TargetServices) / 1e6;
+        double storageMB = static_cast<double>(ServiceHistory::StorageBytes * TargetServices) / 1e6;
+        bool ok = heap <= ServiceHistory::HeapBudgetBytes && heapMB <= TargetMB;
+        withinBudget = withinBudget && ok;
+        std::printf("%-5s service: %zu KiB storage + %zu KiB heap (budget %zu KiB); %zu services: %.1f MB heap %s,"
+                    " %.1f MB mapped, %.1f MB without a history file\n",
+                    name, ServiceHistory::StorageBytes / 1024, heap / 1024, ServiceHistory::HeapBudgetBytes / 1024,
+                    TargetServices, heapMB, ok ? "within target" : "OVER BUDGET", storageMB, heapMB + storageMB);
+    }
+
+    return withinBudget ? 0 : 1;
+}
@@ -0,0 +1,427 @@
+// IPC encoding benchmark: bytes on the wire and end-to-end latency of GET_ALL_STATUS and
+// GET_HISTORY as JSON text and as negotiated binary frames (see WireFormat.h). Requests go
+// through PipeServer on the Unix socket transport to a handler that encodes the way
+// MonitorService does, GET_HISTORY in parts; latency runs from send until the client has
+// reassembled and decoded every value.
+// Build with -DSMC_BUILD_BENCHMARKS=ON (needs nlohmann-json, Linux) and run:
+// IpcBench [services] [samples] [requests]
+
+#include "PipeServer.h"
+#include "ServiceHistory.h"
+#include "ServiceRegistry.h"
+#include "WireFormat.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace smc;
+using json = nlohmann::json;
+
+namespace {
+
+constexpr const wchar_t* SocketPath = L"/tmp/SmcIpcBench";
+constexpr size_t ReceiveBufferBytes = 16 << 20;
+constexpr int WarmupRequests = 10;
+
+struct Fixture {
+    ServiceRegistry registry;
+    std::vector<ServiceId> ids;
+    std::vector<std::unique_ptr<ServiceHistory>> history;   // by ServiceId
+};
+
+/// Services with 1 s samples: mostly idle CPU with bursts, slowly drifting working set.
+void Populate(Fixture& fixture, size_t services, size_t samples)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    int64_t start = 1'700'000'000'000LL;
+    for (size_t s = 0; s < services; ++s) {
+        ServiceId id = fixture.registry.InternUtf8("BenchService" + std::to_string(s));
+        fixture.ids.push_back(id);
+        fixture.history.push_back(std::make_unique<ServiceHistory>());
+        double memory = 20.0 + 200.0 * unit(rng);
+        for (size_t i = 0; i < samples; ++i) {
+            double cpu = unit(rng) < 0.1 ? unit(rng) * 40.0 : 0.0;
+            memory += unit(rng) < 0.05 ? (unit(rng) - 0.5) * 2.0 : 0.0;
+            fixture.history[id]->Push(start + static_cast<int64_t>(i) * 1000, cpu, memory);
+        }
+    }
+}
+
+/// A whole-ring raw GET_HISTORY in parts of at most PartPoints samples, as
+/// MonitorService::NextHistoryPart sends it.
+struct HistoryStream {
+    size_t service = 0;                 // next entry of Fixture::ids
+    size_t offset = 0;                  // its samples already sent
+    bool copied = false;                // samples holds its series
+    bool done = false;                  // the last part has been serialized
+    HistoryRing::Samples samples;
+};
+constexpr size_t PartPoints = 1024;     // MonitorService::HistoryPartPoints
+
+void NextHistoryPart(const Fixture& fixture, HistoryStream& stream, IpcSession& session, std::string& message)
+{
+    auto all = std::numeric_limits<int64_t>::max();
+    std::string body;
+    wire::FrameWriter series(body);
+    std::vector<ServiceId> ids;
+    size_t budget = PartPoints;
+    while (stream.service < fixture.ids.size() && budget > 0) {
+        ServiceId id = fixture.ids[stream.service];
+        if (!stream.copied) {
+            fixture.history[id]->CopyRaw(-all, all, stream.samples);
+            stream.copied = true;
+            stream.offset = 0;
+        }
+        size_t count = std::min(stream.samples.Size() - stream.offset, budget);
+        if (session.binaryFrames) {
+            ids.push_back(id);
+            series.RawSeries(id, stream.samples, stream.offset, count);
+        }
+        else {
+            auto first = static_cast<std::ptrdiff_t>(stream.offset);
+            auto last = first + static_cast<std::ptrdiff_t>(count);
+            json svc;
+            svc["name"] = fixture.registry.Utf8Name(id);
+            svc["timestamps"] = std::vector<int64_t>(stream.samples.timestampsMs.begin() + first,
+                                                     stream.samples.timestampsMs.begin() + last);
+            svc["cpu"] = std::vector<double>(stream.samples.cpu.begin() + first, stream.samples.cpu.begin() + last);
+            svc["memoryMB"] = std::vector<double>(stream.samples.memory.begin() + first,
+                                                  stream.samples.memory.begin() + last);
+            if (!body.empty())
+                body += ',';
+            body += svc.dump();
+        }
+        budget -= std::max<size_t>(count, 1);
+        stream.offset += count;
+        if (stream.offset == stream.samples.Size()) {
+            ++stream.service;
+            stream.copied = false;
+        }
+    }
+    stream.done = stream.service == fixture.ids.size();
+
+    if (session.binaryFrames) {
+        wire::FrameWriter writer(message, stream.done ? wire::FrameKind::History : wire::FrameKind::HistoryPart);
+        writer.Byte(static_cast<uint8_t>(ServiceHistory::Resolution::Raw));
+        writer.String("0.0");
+        writer.Byte(false);
+        writer.Names(ids, fixture.registry, session.namesSent);
+        writer.Varint(ids.size());
+        writer.Append(body);
+        writer.Finish();
+        return;
+    }
+
+    json head;
+    head["status"] = "OK";
+    head["resolution"] = "raw";
+    head["cursor"] = "0.0";
+    head["behind"] = false;
+    if (!stream.done)
+        head["more"] = true;
+    message = head.dump();
+    message.pop_back();
+    message += R"(,"services":[)";
+    message += body;
+    message += "]}";
+}
+
+/// HELLO, GET_ALL_STATUS and a whole-ring raw GET_HISTORY, encoded as in MonitorService.
+std::string Handle(const Fixture& fixture, const std::string& request, IpcSession& session)
+{
+    auto req = json::parse(request);
+    std::string command = req.value("command", "");
+    json resp;
+
+    if (command == "HELLO") {
+        session.binaryFrames = req.value("encodings", json::array()).front() == "binary";
+        resp["status"] = "OK";
+        resp["protocolVersion"] = wire::ProtocolVersion;
+        resp["encoding"] = session.binaryFrames ? "binary" : "json";
+        return resp.dump();
+    }
+
+    if (command == "GET_ALL_STATUS") {
+        if (session.binaryFrames) {
+            std::string frame;
+            wire::FrameWriter writer(frame, wire::FrameKind::AllStatus);
+            writer.Names(fixture.ids, fixture.registry, session.namesSent);
+            writer.Varint(fixture.ids.size());
+            for (ServiceId id : fixture.ids) {
+                writer.Varint(id);
+                writer.Float(fixture.history[id]->Raw().LatestCpu());
+                writer.Float(fixture.history[id]->Raw().LatestMemory());
+            }
+            writer.Finish();
+            return frame;
+        }
+        json services = json::array();
+        for (ServiceId id : fixture.ids) {
+            json svc;
+            svc["name"] = fixture.registry.Utf8Name(id);
+            svc["cpu"] = fixture.history[id]->Raw().LatestCpu();
+            svc["memoryMB"] = fixture.history[id]->Raw().LatestMemory();
+            services.push_back(svc);
+        }
+        resp["status"] = "OK";
+        resp["services"] = services;
+        return resp.dump();
+    }
+
+    if (command == "GET_HISTORY") {
+        // Each part is serialized only once the previous one is out
+        auto stream = std::make_shared<HistoryStream>();
+        std::string message;
+        NextHistoryPart(fixture, *stream, session, message);
+        if (!stream->done) {
+            session.nextMessage = [&fixture, stream](IpcSession& client, std::string& next) {
+                if (stream->done)
+                    return false;
+                NextHistoryPart(fixture, *stream, client, next);
+                return true;
+            };
+        }
+        return message;
+    }
+
+    resp["error"] = "Unknown command: " + command;
+    return resp.dump();
+}
+
+/// Blocking SEQPACKET client: one message per request and per response part.
+class Client {
+public:
+    ~Client()
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    bool Connect()
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::string path = std::filesystem::path(SocketPath).string();
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        fd_ = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        return fd_ >= 0 && ::connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    bool Send(const std::string& request)
+    {
+        return ::send(fd_, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size());
+    }
+
+    /// The next message, or an empty view if the receive failed. Valid until the next call.
+    std::string_view Receive()
+    {
+        ssize_t bytes = ::recv(fd_, buffer_.data(), buffer_.size(), MSG_TRUNC);
+        if (bytes <= 0 || static_cast<size_t>(bytes) > buffer_.size())
+            return {};
+        return { buffer_.data(), static_cast<size_t>(bytes) };
+    }
+
+    /// A single-message exchange.
+    std::string_view Call(const std::string& request)
+    {
+        return Send(request) ? Receive() : std::string_view();
+    }
+
+private:
+    int fd_ = -1;
+    std::vector<char> buffer_ = std::vector<char>(ReceiveBufferBytes);
+};
+
+/// One service of a response, reassembled from every part that carries some of it.
+/// A GET_ALL_STATUS entry is one value and no timestamps.
+struct Series {
+    std::string name;
+    std::vector<int64_t> timestampsMs;
+    std::vector<double> cpu;
+    std::vector<double> memory;
+};
+
+enum class Part { Last, More, Bad };
+
+/// The series `name` continues, if the previous part ended with it, or a new one.
+Series& SeriesFor(std::vector<Series>& response, const std::string& name)
+{
+    if (response.empty() || response.back().name != name)
+        response.push_back({ name, {}, {}, {} });
+    return response.back();
+}
+
+/// Decode every value of one response part, as a client would, into `response`.
+Part DecodeJson(std::string_view text, std::vector<Series>& response)
+{
+    auto part = json::parse(text, nullptr, false);
+    if (part.is_discarded() || !part.contains("services"))
+        return Part::Bad;
+    for (const auto& svc : part.at("services")) {
+        Series& series = SeriesFor(response, svc.at("name").get<std::string>());
+        if (svc.at("cpu").is_array()) {
+            for (const auto& t : svc.at("timestamps")) series.timestampsMs.push_back(t.get<int64_t>());
+            for (const auto& v : svc.at("cpu")) series.cpu.push_back(v.get<double>());
+            for (const auto& v : svc.at("memoryMB")) series.memory.push_back(v.get<double>());
+        }
+        else {
+            series.cpu.push_back(svc.at("cpu").get<double>());
+            series.memory.push_back(svc.at("memoryMB").get<double>());
+        }
+    }
+    return part.value("more", false) ? Part::More : Part::Last;
+}
+
+Part DecodeFrame(std::string_view frame, std::vector<std::string>& names, std::vector<Series>& response)
+{
+    wire::FrameReader reader(frame);
+    bool history = reader.Kind() == wire::FrameKind::History || reader.Kind() == wire::FrameKind::HistoryPart;
+    if (history) {
+        reader.Byte();
+        reader.String();
+        reader.Byte();
+    }
+    for (uint64_t n = reader.Varint(); n > 0 && reader.Ok(); --n) {
+        auto id = reader.Varint();
+        if (id >= names.size())
+            names.resize(id + 1);
+        names[id] = reader.String();
+    }
+
+    std::vector<int64_t> timestamps;
+    std::vector<double> cpu, memory;
+    for (uint64_t n = reader.Varint(); n > 0 && reader.Ok(); --n) {
+        auto id = reader.Varint();
+        if (id >= names.size())
+            return Part::Bad;
+        size_t count = history ? reader.Varint() : 1;
+        if (history)
+            reader.Timestamps(count, timestamps);
+        reader.Floats(count, cpu);
+        reader.Floats(count, memory);
+        Series& series = SeriesFor(response, names[id]);
+        series.timestampsMs.insert(series.timestampsMs.end(), timestamps.begin(), timestamps.end());
+        series.cpu.insert(series.cpu.end(), cpu.begin(), cpu.end());
+        series.memory.insert(series.memory.end(), memory.begin(), memory.end());
+    }
+    if (!reader.Ok())
+        return Part::Bad;
+    return reader.Kind() == wire::FrameKind::HistoryPart ? Part::More : Part::Last;
+}
+
+/// Fold a whole response into one number, equal for both encodings.
+double Checksum(const std::vector<Series>& response)
+{
+    double checksum = 0.0;
+    for (const auto& series : response) {
+        checksum += static_cast<double>(series.name.size());
+        for (int64_t t : series.timestampsMs) checksum += static_cast<double>(t & 0xFF);
+        for (double v : series.cpu) checksum += v;
+        for (double v : series.memory) checksum += v;
+    }
+    return checksum;
+}
+
+void Run(const char* command, bool binary, int requests)
+{
+    Client client;
+    if (!client.Connect()) {
+        std::printf("connect failed\n");
+        return;
+    }
+    if (binary && client.Call(R"({"command":"HELLO","encodings":["binary"]})").empty()) {
+        std::printf("HELLO failed\n");
+        return;
+    }
+
+    std::string request = std::string(R"({"command":")") + command + R"("})";
+    std::vector<std::string> names;
+    std::vector<Series> response;
+    std::vector<double> latencyUs;
+    size_t firstBytes = 0, bytes = 0, parts = 0;
+    double checksum = 0.0;
+    for (int i = 0; i < WarmupRequests + requests; ++i) {
+        // Latency runs until the last part is decoded
+        auto t0 = std::chrono::steady_clock::now();
+        bool sent = client.Send(request);
+        response.clear();
+        bytes = parts = 0;
+        Part part = sent ? Part::More : Part::Bad;
+        while (part == Part::More) {
+            auto message = client.Receive();
+            if (message.empty()) {
+                part = Part::Bad;
+                break;
+            }
+            bytes += message.size();
+            ++parts;
+            part = binary ? DecodeFrame(message, names, response) : DecodeJson(message, response);
+        }
+        if (part == Part::Bad) {
+            std::printf("%-15s %-7s request failed (a message must fit the socket send buffer)\n",
+                        command, binary ? "binary" : "json");
+            return;
+        }
+        checksum = Checksum(response);
+        auto t1 = std::chrono::steady_clock::now();
+        if (i == 0) firstBytes = bytes;
+        if (i >= WarmupRequests)
+            latencyUs.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+    }
+
+    std::sort(latencyUs.begin(), latencyUs.end());
+    std::printf("%-15s %-7s %10zu B first %10zu B after in %5zu parts %10.1f us median %10.1f us p99  (checksum %.1f)\n",
+                command, binary ? "binary" : "json", firstBytes, bytes, parts,
+                latencyUs[latencyUs.size() / 2], latencyUs[latencyUs.size() * 99 / 100], checksum);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    size_t services = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10;
+    size_t samples = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 300;
+    int requests = argc > 3 ? std::atoi(argv[3]) : 200;
+    if (services == 0 || samples == 0 || requests <= 0) {
+        std::printf("usage: IpcBench [services] [samples] [requests]\n");
+        return 1;
+    }
+
+    Fixture fixture;
+    Populate(fixture, services, samples);
+
+    PipeServer server(SocketPath);
+    server.SetMessageHandler([&fixture](const std::string& request, IpcSession& session) {
+        return Handle(fixture, request, session);
+    });
+    server.Start();
+    if (!server.IsRunning())
+        return 1;
+
+    std::printf("%zu services x %zu samples, %d requests\n", services, samples, requests);
+    for (const char* command : { "GET_ALL_STATUS", "GET_HISTORY" }) {
+        Run(command, false, requests);
+        Run(command, true, requests);
+    }
+
+    server.Stop();
+    return 0;
+}
@@ -0,0 +1,209 @@
+// IPC load benchmark: many clients connected at once, each polling at a fixed interval
+// as a UI or script does. Requests go through PipeServer on the Unix socket transport to
+// a handler that answers GET_ALL_STATUS as JSON the way MonitorService does. Every client
+// connects before any of them sends, so a server that served one client at a time would
+// stall here. Clients start spread over one interval. Reports per-request latency over
+// all clients against the 50 ms response target; an interval of 0 sends back to back
+// and measures throughput instead.
+// Build with -DSMC_BUILD_BENCHMARKS=ON (needs nlohmann-json, Linux) and run:
+// IpcLoadBench [clients] [requests per client] [interval ms] [services]
+// Exits with 1 on a failed request or, when polling, a p99 over the target.
+
+#include "PipeServer.h"
+#include "ServiceHistory.h"
+#include "ServiceRegistry.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <latch>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace smc;
+using json = nlohmann::json;
+
+namespace {
+
+constexpr const wchar_t* SocketPath = L"/tmp/SmcIpcLoadBench";
+constexpr size_t ReceiveBufferBytes = 1 << 20;
+constexpr double TargetMs = 50.0;
+
+struct Fixture {
+    ServiceRegistry registry;
+    std::vector<ServiceId> ids;
+    std::vector<std::unique_ptr<ServiceHistory>> history;   // by ServiceId
+};
+
+/// Services with a minute of 1 s samples; only the latest is read here.
+void Populate(Fixture& fixture, size_t services)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    int64_t start = 1'700'000'000'000LL;
+    for (size_t s = 0; s < services; ++s) {
+        ServiceId id = fixture.registry.InternUtf8("LoadService" + std::to_string(s));
+        fixture.ids.push_back(id);
+        fixture.history.push_back(std::make_unique<ServiceHistory>());
+        for (int64_t i = 0; i < 60; ++i)
+            fixture.history[id]->Push(start + i * 1000, unit(rng) * 10.0, 20.0 + unit(rng) * 200.0);
+    }
+}
+
+/// GET_ALL_STATUS as JSON, as in MonitorService.
+std::string Handle(const Fixture& fixture, const std::string& request)
+{
+    auto req = json::parse(request);
+    json resp;
+    if (req.value("command", "") != "GET_ALL_STATUS") {
+        resp["error"] = "Unknown command";
+        return resp.dump();
+    }
+
+    json services = json::array();
+    for (ServiceId id : fixture.ids) {
+        json svc;
+        svc["name"] = fixture.registry.Utf8Name(id);
+        svc["cpu"] = fixture.history[id]->Raw().LatestCpu();
+        svc["memoryMB"] = fixture.history[id]->Raw().LatestMemory();
+        services.push_back(svc);
+    }
+    resp["status"] = "OK";
+    resp["services"] = services;
+    return resp.dump();
+}
+
+/// Blocking SEQPACKET client: one message per request and per response.
+class Client {
+public:
+    ~Client()
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    bool Connect()
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::string path = std::filesystem::path(SocketPath).string();
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        fd_ = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        return fd_ >= 0 && ::connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    /// The response's length, or 0 if the exchange failed.
+    size_t Call(const std::string& request)
+    {
+        if (::send(fd_, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size()))
+            return 0;
+        ssize_t bytes = ::recv(fd_, buffer_.data(), buffer_.size(), MSG_TRUNC);
+        if (bytes <= 0 || static_cast<size_t>(bytes) > buffer_.size())
+            return 0;
+        return static_cast<size_t>(bytes);
+    }
+
+private:
+    int fd_ = -1;
+    std::vector<char> buffer_ = std::vector<char>(ReceiveBufferBytes);
+};
+
+double Percentile(const std::vector<double>& sorted, double q)
+{
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(q * static_cast<double>(sorted.size())))];
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    size_t clients = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 128;
+    size_t requests = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100;
+    int64_t intervalMs = argc > 3 ? std::strtoll(argv[3], nullptr, 10) : 100;
+    size_t services = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 300;
+    if (clients == 0 || requests == 0 || intervalMs < 0 || services == 0) {
+        std::printf("usage: IpcLoadBench [clients] [requests per client] [interval ms] [services]\n");
+        return 1;
+    }
+
+    Fixture fixture;
+    Populate(fixture, services);
+
+    PipeServer server(SocketPath);
+    server.SetMessageHandler([&fixture](const std::string& request, IpcSession&) {
+        return Handle(fixture, request);
+    });
+    server.Start();
+    if (!server.IsRunning())
+        return 1;
+
+    std::printf("%zu clients x %zu requests every %lld ms, GET_ALL_STATUS of %zu services\n",
+                clients, requests, static_cast<long long>(intervalMs), services);
+
+    const std::string request = R"({"command":"GET_ALL_STATUS"})";
+    std::vector<std::vector<double>> latencyMs(clients);
+    std::atomic<size_t> failures{ 0 };
+    std::latch connected(static_cast<std::ptrdiff_t>(clients));
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            Client client;
+            bool ok = client.Connect();
+            connected.arrive_and_wait();
+            if (!ok) {
+                failures += requests;
+                return;
+            }
+            latencyMs[c].reserve(requests);
+            auto interval = std::chrono::milliseconds(intervalMs);
+            auto due = std::chrono::steady_clock::now() + interval * c / clients;
+            for (size_t i = 0; i < requests; ++i, due += interval) {
+                std::this_thread::sleep_until(due);
+                auto t0 = std::chrono::steady_clock::now();
+                if (client.Call(request) == 0) {
+                    failures += requests - i;
+                    return;
+                }
+                auto t1 = std::chrono::steady_clock::now();
+                latencyMs[c].push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+            }
+        });
+    }
+    connected.wait();
+    auto start = std::chrono::steady_clock::now();
+    for (auto& thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    server.Stop();
+
+    std::vector<double> all;
+    for (const auto& perClient : latencyMs)
+        all.insert(all.end(), perClient.begin(), perClient.end());
+    if (all.empty()) {
+        std::printf("every request failed\n");
+        return 1;
+    }
+    std::sort(all.begin(), all.end());
+    double p99 = Percentile(all, 0.99);
+    bool met = intervalMs == 0 || p99 <= TargetMs;
+    std::printf("%zu requests in %.2f s (%.0f/s), %zu failed\n", all.size(), seconds,
+                static_cast<double>(all.size()) / seconds, failures.load());
+    std::printf("latency  p50 %.2f ms  p99 %.2f ms  max %.2f ms  (target %.0f ms: %s)\n",
+                Percentile(all, 0.5), p99, all.back(), TargetMs,
+                intervalMs == 0 ? "not checked back to back" : met ? "met" : "MISSED");
+    return failures.load() == 0 && met ? 0 : 1;
+}
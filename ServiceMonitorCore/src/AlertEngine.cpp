@@ -0,0 +1,280 @@
+#include "AlertEngine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace smc {
+
+namespace {
+
+const char* const DefaultRules[] = {
+    "cpu > 80 for 60s",
+    "memory zscore > 4",
+};
+
+bool ParseDuration(const std::string& token, int64_t& ms)
+{
+    size_t unitStart = token.find_first_not_of("0123456789.");
+    if (unitStart == 0 || unitStart == std::string::npos)
+        return false;
+
+    double value = 0.0;
+    try {
+        value = std::stod(token.substr(0, unitStart));
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    std::string unit = token.substr(unitStart);
+    double scale = unit == "ms" ? 1.0 : unit == "s" ? 1000.0 : unit == "m" ? 60'000.0 : unit == "h" ? 3'600'000.0 : 0.0;
+    if (scale == 0.0)
+        return false;
+    ms = static_cast<int64_t>(value * scale);
+    return true;
+}
+
+} // anonymous namespace
+
+bool AlertRule::Compile(const std::string& text, AlertRule& rule, std::string& error)
+{
+    std::istringstream in(text);
+    std::vector<std::string> tokens;
+    for (std::string token; in >> token;)
+        tokens.push_back(token);
+
+    rule = AlertRule{};
+    rule.text = text;
+    size_t i = 0;
+
+    if (i < tokens.size() && tokens[i] == "cpu")
+        rule.metric = Metric::Cpu;
+    else if (i < tokens.size() && tokens[i] == "memory")
+        rule.metric = Metric::Memory;
+    else {
+        error = "expected metric cpu or memory";
+        return false;
+    }
+    ++i;
+
+    if (i < tokens.size() && tokens[i] == "zscore") {
+        rule.kind = Kind::ZScore;
+        ++i;
+    }
+
+    if (i < tokens.size() && (tokens[i] == ">" || tokens[i] == "<")) {
+        rule.above = tokens[i] == ">";
+        ++i;
+    }
+    else {
+        error = "expected > or <";
+        return false;
+    }
+
+    if (i >= tokens.size()) {
+        error = "expected a threshold";
+        return false;
+    }
+    std::string number = tokens[i++];
+    if (!number.empty() && number.back() == '%')
+        number.pop_back();
+    size_t used = 0;
+    try {
+        rule.threshold = std::stod(number, &used);
+    }
+    catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != number.size()) {
+        error = "invalid threshold: " + tokens[i - 1];
+        return false;
+    }
+
+    if (i < tokens.size() && tokens[i] == "for") {
+        ++i;
+        if (i >= tokens.size() || !ParseDuration(tokens[i], rule.forMs)) {
+            error = "invalid duration, expected e.g. 500ms, 60s, 5m or 1h";
+            return false;
+        }
+        ++i;
+    }
+
+    if (i != tokens.size()) {
+        error = "unexpected: " + tokens[i];
+        return false;
+    }
+    return true;
+}
+
+AlertEngine::AlertEngine()
+    : events_(EventCapacity)
+{
+    for (const char* text : DefaultRules) {
+        AlertRule rule;
+        std::string error;
+        if (AlertRule::Compile(text, rule, error)) {
+            rule.id = nextRuleId_++;
+            rules_.push_back(std::move(rule));
+        }
+    }
+    ruleSet_ = rules_;
+}
+
+std::vector<uint32_t> AlertEngine::SetRules(std::vector<AlertRule> rules)
+{
+    std::lock_guard lock(rulesMutex_);
+    std::vector<uint32_t> ids;
+    ids.reserve(rules.size());
+    for (auto& rule : rules) {
+        rule.id = nextRuleId_++;
+        ids.push_back(rule.id);
+    }
+    pendingRules_ = std::move(rules);
+    rulesPending_ = true;
+    return ids;
+}
+
+std::vector<AlertRule> AlertEngine::Rules() const
+{
+    std::lock_guard lock(eventsMutex_);
+    return ruleSet_;
+}
+
+void AlertEngine::BeginTick(int64_t nowMs)
+{
+    {
+        std::lock_guard lock(rulesMutex_);
+        if (!rulesPending_)
+            return;
+        rules_ = std::move(pendingRules_);
+        pendingRules_.clear();
+        rulesPending_ = false;
+    }
+    states_.clear();
+
+    std::lock_guard lock(eventsMutex_);
+    ruleSet_ = rules_;
+
+    // Close out alerts of the old rule set so clients see every firing resolved
+    auto active = std::move(active_);
+    active_.clear();
+    for (const auto& alert : active) {
+        AlertEvent& event = events_[lastSequence_ % EventCapacity];
+        event = AlertEvent{ ++lastSequence_, nowMs, alert.service, alert.ruleId, alert.rule, false, 0.0 };
+    }
+}
+
+void AlertEngine::Evaluate(ServiceId id, int64_t timestampMs, double cpuPercent, double memoryMB)
+{
+    if (rules_.empty())
+        return;
+    if (id >= states_.size())
+        states_.resize(id + 1);
+    auto& states = states_[id];
+    if (states.size() != rules_.size())
+        states.resize(rules_.size());
+
+    for (uint32_t r = 0; r < rules_.size(); ++r) {
+        const AlertRule& rule = rules_[r];
+        RuleState& state = states[r];
+        double sample = rule.metric == AlertRule::Metric::Cpu ? cpuPercent : memoryMB;
+
+        double value = sample;
+        bool measurable = true;
+        if (rule.kind == AlertRule::Kind::ZScore) {
+            // Score against the baseline before this sample, then fold it in
+            double stdDev = std::max({ std::sqrt(state.variance), std::abs(state.mean) * 0.01, ZScoreMinStdDev });
+            value = (sample - state.mean) / stdDev;
+            measurable = state.samples >= ZScoreWarmup;
+
+            if (state.samples == 0) {
+                state.mean = sample;
+            }
+            else {
+                double delta = sample - state.mean;
+                state.mean += ZScoreAlpha * delta;
+                state.variance = (1.0 - ZScoreAlpha) * (state.variance + ZScoreAlpha * delta * delta);
+            }
+            if (state.samples < ZScoreWarmup)
+                ++state.samples;
+        }
+
+        bool breach = measurable && (rule.above ? value > rule.threshold : value < rule.threshold);
+        if (breach && !state.breaching) {
+            state.breaching = true;
+            state.breachStartMs = timestampMs;
+        }
+        else if (!breach) {
+            state.breaching = false;
+        }
+
+        bool fire = breach && timestampMs - state.breachStartMs >= rule.forMs;
+        if (fire != state.firing) {
+            state.firing = fire;
+            Emit(id, rule, timestampMs, fire, value);
+        }
+    }
+}
+
+void AlertEngine::EndTick(std::span<const ServiceId> present, int64_t nowMs)
+{
+    // Both are ordered by id, so one merge walk finds the services that dropped out
+    size_t p = 0;
+    for (ServiceId id = 0; id < states_.size(); ++id) {
+        if (states_[id].empty())
+            continue;
+        while (p < present.size() && present[p] < id)
+            ++p;
+        if (p < present.size() && present[p] == id)
+            continue;
+
+        // A stopped or deleted service gets no more samples to resolve its alerts
+        for (uint32_t r = 0; r < states_[id].size(); ++r) {
+            if (states_[id][r].firing)
+                Emit(id, rules_[r], nowMs, false, 0.0);
+        }
+        states_[id].clear();
+    }
+}
+
+void AlertEngine::Emit(ServiceId id, const AlertRule& rule, int64_t timestampMs, bool firing, double value)
+{
+    std::lock_guard lock(eventsMutex_);
+    AlertEvent& event = events_[lastSequence_ % EventCapacity];
+    event = AlertEvent{ ++lastSequence_, timestampMs, id, rule.id, rule.text, firing, value };
+
+    if (firing) {
+        active_.push_back(ActiveAlert{ id, rule.id, rule.text, timestampMs });
+    }
+    else {
+        auto it = std::find_if(active_.begin(), active_.end(),
+                               [&](const ActiveAlert& a) { return a.service == id && a.ruleId == rule.id; });
+        if (it != active_.end())
+            active_.erase(it);
+    }
+}
+
+bool AlertEngine::EventsSince(uint64_t sinceSequence, std::vector<AlertEvent>& out) const
+{
+    out.clear();
+    std::lock_guard lock(eventsMutex_);
+    uint64_t oldest = lastSequence_ > EventCapacity ? lastSequence_ - EventCapacity + 1 : 1;
+    uint64_t first = std::max(sinceSequence + 1, oldest);
+    for (uint64_t sequence = first; sequence <= lastSequence_; ++sequence)
+        out.push_back(events_[(sequence - 1) % EventCapacity]);
+    return sinceSequence + 1 >= oldest;
+}
+
+std::vector<AlertEngine::ActiveAlert> AlertEngine::Active() const
+{
+    std::lock_guard lock(eventsMutex_);
+    return active_;
+}
+
+uint64_t AlertEngine::LastSequence() const
+{
+    std::lock_guard lock(eventsMutex_);
+    return lastSequence_;
+}
+
+} // namespace smc
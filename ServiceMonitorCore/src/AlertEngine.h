@@ -0,0 +1,119 @@
+#pragma once
+
+#include "ServiceRegistry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace smc {
+
+/// One alert rule, compiled from text such as
+///   "cpu > 80 for 60s"      threshold held for a duration (ms, s, m or h)
+///   "memory zscore > 4"     deviation from the EWMA baseline, in standard deviations
+/// Metrics are `cpu` (percent) and `memory` (MB); comparisons are `>` and `<`.
+struct AlertRule {
+    enum class Metric { Cpu, Memory };
+    enum class Kind { Threshold, ZScore };
+
+    uint32_t id = 0;                // assigned by AlertEngine::SetRules(), never reused
+    std::string text;
+    Metric metric = Metric::Cpu;
+    Kind kind = Kind::Threshold;
+    bool above = true;
+    double threshold = 0.0;
+    int64_t forMs = 0;
+
+    /// Parse `text` into `rule`. On failure returns false and sets `error`.
+    static bool Compile(const std::string& text, AlertRule& rule, std::string& error);
+};
+
+/// A rule starting or stopping to fire for one service.
+struct AlertEvent {
+    uint64_t sequence = 0;          // increases by one per event, from 1
+    int64_t timestampMs = 0;
+    ServiceId service = 0;
+    uint32_t ruleId = 0;
+    std::string rule;               // rule text
+    bool firing = false;            // false = resolved
+    double value = 0.0;             // metric (threshold rules) or z-score at the transition
+};
+
+/// Evaluates alert rules incrementally on every sample, with a fixed-size state per
+/// rule and service, so cost per tick does not depend on how much history is kept.
+/// Transitions go into a bounded event ring that clients page through by sequence.
+/// SetRules() and the query methods are thread-safe; the rest is for the monitor thread.
+class AlertEngine {
+public:
+    static constexpr size_t EventCapacity = 1024;
+    static constexpr double ZScoreAlpha = 0.05;     // EWMA weight of a new sample
+    static constexpr uint32_t ZScoreWarmup = 30;    // samples before a baseline is trusted
+    static constexpr double ZScoreMinStdDev = 0.1;  // in metric units; also at least 1% of the mean
+
+    struct ActiveAlert {
+        ServiceId service = 0;
+        uint32_t ruleId = 0;
+        std::string rule;
+        int64_t sinceMs = 0;
+    };
+
+    AlertEngine();
+
+    /// Replace the rule set; applied at the next BeginTick(), which resets all rule state
+    /// and resolves alerts that were firing. Assigns each rule its id and returns them in order.
+    std::vector<uint32_t> SetRules(std::vector<AlertRule> rules);
+
+    /// The rules in effect.
+    std::vector<AlertRule> Rules() const;
+
+    /// Apply a pending SetRules(); resolutions it causes are stamped nowMs.
+    void BeginTick(int64_t nowMs);
+
+    /// Feed one sample of a service through every rule.
+    void Evaluate(ServiceId id, int64_t timestampMs, double cpuPercent, double memoryMB);
+
+    /// Resolve the alerts of services missing from `present` (sorted ids of the services
+    /// running this tick) and forget their rule state, so a restart starts afresh.
+    void EndTick(std::span<const ServiceId> present, int64_t nowMs);
+
+    /// Events with sequence > sinceSequence that are still retained, oldest first.
+    /// Returns false if older events after sinceSequence were already dropped.
+    bool EventsSince(uint64_t sinceSequence, std::vector<AlertEvent>& out) const;
+
+    /// Rules firing right now.
+    std::vector<ActiveAlert> Active() const;
+
+    /// Sequence of the newest event, 0 if none.
+    uint64_t LastSequence() const;
+
+private:
+    struct RuleState {
+        int64_t breachStartMs = 0;
+        bool breaching = false;
+        bool firing = false;
+        uint32_t samples = 0;       // z-score baseline
+        double mean = 0.0;
+        double variance = 0.0;
+    };
+
+    void Emit(ServiceId id, const AlertRule& rule, int64_t timestampMs, bool firing, double value);
+
+    std::vector<AlertRule> rules_;                  // monitor thread
+    std::vector<std::vector<RuleState>> states_;    // [ServiceId][rule]
+
+    std::mutex rulesMutex_;
+    bool rulesPending_ = false;
+    std::vector<AlertRule> pendingRules_;
+    uint32_t nextRuleId_ = 1;
+
+    mutable std::mutex eventsMutex_;
+    std::vector<AlertRule> ruleSet_;                // copy of rules_ for readers
+    std::vector<AlertEvent> events_;                // ring of EventCapacity
+    uint64_t lastSequence_ = 0;
+    std::vector<ActiveAlert> active_;
+};
+
+} // namespace smc
@@ -0,0 +1,220 @@
+#include "CgroupServiceCollector.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace smc {
+
+namespace {
+
+uint64_t MonotonicMicroseconds()
+{
+    timespec ts{};
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000ULL + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+bool EndsWith(const char* name, const char* suffix)
+{
+    size_t nameLen = std::strlen(name);
+    size_t suffixLen = std::strlen(suffix);
+    return nameLen > suffixLen && std::strcmp(name + nameLen - suffixLen, suffix) == 0;
+}
+
+bool IsDirectory(const std::string& parent, const dirent* entry)
+{
+    if (entry->d_type == DT_DIR)
+        return true;
+    if (entry->d_type != DT_UNKNOWN)
+        return false;
+
+    struct stat st{};
+    std::string path = parent + '/' + entry->d_name;
+    return ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+} // anonymous namespace
+
+CgroupServiceCollector::CgroupServiceCollector(std::string root)
+    : root_(std::move(root))
+{
+    long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+    numProcessors_ = cpus > 0 ? static_cast<int>(cpus) : 1;
+}
+
+bool CgroupServiceCollector::Collect(std::vector<UnitMetrics>& units)
+{
+    struct stat st{};
+    if (::stat(root_.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+        return false;
+
+    ++generation_;
+    uint64_t nowUs = MonotonicMicroseconds();
+
+    size_t used = 0;
+    Walk(root_, nowUs, units, used);
+    units.resize(used);
+
+    // Drop baselines of units that have stopped (their cgroup is gone)
+    std::erase_if(baselines_, [this](const auto& item) { return item.second.lastSeen != generation_; });
+    return true;
+}
+
+void CgroupServiceCollector::Walk(const std::string& path, uint64_t nowUs,
+                                  std::vector<UnitMetrics>& units, size_t& used)
+{
+    DIR* dir = ::opendir(path.c_str());
+    if (!dir)
+        return;
+
+    while (dirent* entry = ::readdir(dir)) {
+        if (entry->d_name[0] == '.' || !IsDirectory(path, entry))
+            continue;
+
+        std::string child = path + '/' + entry->d_name;
+
+        // A unit's sub-cgroups belong to the unit; only slices and scopes are descended
+        if (EndsWith(entry->d_name, ".service")) {
+            if (used == units.size())
+                units.emplace_back();
+            ReadUnit(child, entry->d_name, nowUs, units[used++]);
+        }
+        else {
+            Walk(child, nowUs, units, used);
+        }
+    }
+
+    ::closedir(dir);
+}
+
+void CgroupServiceCollector::ReadUnit(const std::string& path, const char* name, uint64_t nowUs,
+                                      UnitMetrics& unit)
+{
+    // systemd escapes unit names to ASCII, so widening byte by byte is exact
+    unit.name.assign(name, name + std::strlen(name));
+    unit.metrics = {};
+    unit.processCount = 0;
+
+    uint64_t usageUs = 0;
+    if (ReadFile(path + "/cpu.stat") > 0) {
+        if (const char* field = std::strstr(buffer_.data(), "usage_usec "))
+            usageUs = std::strtoull(field + 11, nullptr, 10);
+    }
+    Baseline& state = BaselineFor(path);
+    unit.metrics.cpuPercent = CalculateCpuUsage(state, nowUs, usageUs);
+
+    // memory.current is absent when the memory controller is not enabled for the subtree
+    if (ReadFile(path + "/memory.current") > 0)
+        unit.metrics.memoryMB = static_cast<double>(std::strtoull(buffer_.data(), nullptr, 10)) / (1024.0 * 1024.0);
+
+    if (ReadFile(path + "/pids.current") > 0)
+        unit.processCount = std::strtoull(buffer_.data(), nullptr, 10);
+
+    unit.metrics.uptimeSeconds = UptimeSeconds(path, state);
+
+    unit.metrics.status = ServiceStateName(ServiceState::Running);
+}
+
+CgroupServiceCollector::Baseline& CgroupServiceCollector::BaselineFor(const std::string& path)
+{
+    Baseline& state = baselines_[path];
+    state.lastSeen = generation_;
+    return state;
+}
+
+double CgroupServiceCollector::CalculateCpuUsage(Baseline& state, uint64_t nowUs, uint64_t usageUs)
+{
+    double percent = 0.0;
+    if (state.lastTimeUs != 0 && nowUs > state.lastTimeUs) {
+        auto usageDelta = usageUs > state.lastUsageUs ? usageUs - state.lastUsageUs : 0;
+        percent = static_cast<double>(usageDelta) / static_cast<double>(nowUs - state.lastTimeUs) * 100.0 / numProcessors_;
+        if (percent > 100.0) percent = 100.0;
+    }
+
+    state.lastTimeUs = nowUs;
+    state.lastUsageUs = usageUs;
+    return percent;
+}
+
+uint64_t CgroupServiceCollector::UptimeSeconds(const std::string& path, Baseline& state)
+{
+    // Processes started later cannot be older, so while the oldest one lives it stays the
+    // answer and costs one /proc read; the cgroup is rescanned only once it has exited
+    ProcessSample sample{};
+    if (state.oldestPid != 0 && processes_.Sample(state.oldestPid, sample) && sample.creationTime == state.oldestStart)
+        return sample.sampleTime > sample.creationTime ? (sample.sampleTime - sample.creationTime) / 10'000'000ULL : 0;
+
+    state.oldestPid = 0;
+    state.oldestStart = 0;
+    uint64_t sampleTime = 0;
+    FindOldestProcess(path, state.oldestPid, state.oldestStart, sampleTime, 0);
+    if (state.oldestPid == 0 || sampleTime <= state.oldestStart)
+        return 0;
+    return (sampleTime - state.oldestStart) / 10'000'000ULL;
+}
+
+void CgroupServiceCollector::FindOldestProcess(const std::string& path, ProcessId& pid, uint64_t& start,
+                                               uint64_t& sampleTime, int depth)
+{
+    // cgroup.procs can outgrow buffer_ for large units, so it is read whole
+    procs_.clear();
+    int fd = ::open((path + "/cgroup.procs").c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        for (;;) {
+            ssize_t n = ::read(fd, buffer_.data(), buffer_.size());
+            if (n <= 0) break;
+            procs_.append(buffer_.data(), static_cast<size_t>(n));
+        }
+        ::close(fd);
+    }
+
+    ProcessSample sample{};
+    for (const char* p = procs_.c_str(); *p;) {
+        char* end = nullptr;
+        unsigned long candidate = std::strtoul(p, &end, 10);
+        if (end == p) break;
+        p = end;
+        if (processes_.Sample(static_cast<ProcessId>(candidate), sample) && sample.creationTime != 0 &&
+            (pid == 0 || sample.creationTime < start)) {
+            pid = static_cast<ProcessId>(candidate);
+            start = sample.creationTime;
+            sampleTime = sample.sampleTime;
+        }
+    }
+
+    // Delegated units keep their processes in child cgroups (no internal processes in v2)
+    if (depth >= 8)
+        return;
+    DIR* dir = ::opendir(path.c_str());
+    if (!dir)
+        return;
+    while (dirent* entry = ::readdir(dir)) {
+        if (entry->d_name[0] != '.' && IsDirectory(path, entry))
+            FindOldestProcess(path + '/' + entry->d_name, pid, start, sampleTime, depth + 1);
+    }
+    ::closedir(dir);
+}
+
+long CgroupServiceCollector::ReadFile(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    ssize_t n = ::read(fd, buffer_.data(), buffer_.size() - 1);
+    ::close(fd);
+    if (n <= 0)
+        return -1;
+
+    buffer_[static_cast<size_t>(n)] = '\0';
+    return static_cast<long>(n);
+}
+
+} // namespace smc
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "LinuxProcessBackend.h"
+#include "ResourceCollector.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace smc {
+
+/// Metrics for one systemd unit, in the same shape the Windows collector reports per service.
+struct UnitMetrics {
+    std::wstring name;              // unit name, e.g. L"sshd.service"
+    ServiceMetrics metrics;
+    uint64_t processCount = 0;
+};
+
+/// Per-service metrics on Linux, read from the cgroup v2 hierarchy.
+/// Every `*.service` directory under the root is one unit; its cpu.stat
+/// usage_usec, memory.current and pids.current give exact per-unit figures
+/// without scanning processes. Child cgroups of a unit are part of that unit.
+/// Uptime is the age of the unit's oldest process, found in cgroup.procs and read
+/// from /proc. The root is a constructor argument so a fake cgroupfs tree can stand in for it.
+/// Not thread-safe: one collector per monitor loop.
+/// Not yet wired into an engine: MonitorService and its pipe host are Windows-only, so
+/// on Linux this is library code for a future host. bench/CgroupBench.cpp drives it,
+/// checking it against a fake cgroupfs tree or listing a host's units.
+class CgroupServiceCollector {
+public:
+    explicit CgroupServiceCollector(std::string root = "/sys/fs/cgroup");
+
+    /// Enumerate units and fill `units` (reused between calls).
+    /// CPU is the usage since the previous Collect(), as a percentage of all CPUs;
+    /// a unit's first sample reports 0. Returns false if the root cannot be read.
+    bool Collect(std::vector<UnitMetrics>& units);
+
+private:
+    using Buffer = std::array<char, 4096>;
+
+    struct Baseline {
+        uint64_t lastTimeUs = 0;
+        uint64_t lastUsageUs = 0;
+        uint64_t lastSeen = 0;
+        ProcessId oldestPid = 0;        // oldest process seen in the unit, 0 if none
+        uint64_t oldestStart = 0;       // its creation time (LinuxProcessBackend timebase)
+    };
+
+    void Walk(const std::string& path, uint64_t nowUs, std::vector<UnitMetrics>& units, size_t& used);
+    void ReadUnit(const std::string& path, const char* name, uint64_t nowUs, UnitMetrics& unit);
+    Baseline& BaselineFor(const std::string& path);
+    double CalculateCpuUsage(Baseline& state, uint64_t nowUs, uint64_t usageUs);
+    uint64_t UptimeSeconds(const std::string& path, Baseline& state);
+
+    /// Find the earliest-started process in a unit's cgroup or its child cgroups.
+    void FindOldestProcess(const std::string& path, ProcessId& pid, uint64_t& start, uint64_t& sampleTime, int depth);
+
+    /// Read a small cgroup file into buffer_. Returns the number of bytes read, or -1.
+    long ReadFile(const std::string& path);
+
+    std::string root_;
+    int numProcessors_ = 1;
+    uint64_t generation_ = 0;
+    std::unordered_map<std::string, Baseline> baselines_;    // keyed by cgroup path
+    Buffer buffer_{};
+    std::string procs_;                 // cgroup.procs contents, reused
+    LinuxProcessBackend processes_;
+};
+
+} // namespace smc
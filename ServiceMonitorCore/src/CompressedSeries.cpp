@@ -0,0 +1,328 @@
+#include "CompressedSeries.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace smc {
+
+namespace {
+
+uint64_t ZigZag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+using PrefixClass = DeltaEncoder::PrefixClass;
+
+// Timestamp delta-of-delta
+constexpr PrefixClass DodClasses[] = {
+    { 0b10, 2, 7 },
+    { 0b110, 3, 9 },
+    { 0b1110, 4, 12 },
+    { 0b11110, 5, 32 },
+    { 0b11111, 5, 64 },
+};
+
+// Column delta in fixed-point steps, wrapped to 32 bits
+constexpr PrefixClass DeltaClasses[] = {
+    { 0b10, 2, 4 },
+    { 0b110, 3, 8 },
+    { 0b1110, 4, 16 },
+    { 0b1111, 4, 32 },
+};
+
+uint32_t ClassedBits(int64_t value, std::span<const PrefixClass> classes)
+{
+    if (value == 0)
+        return 1;
+    uint64_t zz = ZigZag(value);
+    for (const auto& cls : classes) {
+        if (cls.payloadBits == 64 || zz < (1ULL << cls.payloadBits))
+            return cls.prefixBits + cls.payloadBits;
+    }
+    return 0;
+}
+
+template <typename T>
+void StoreRelaxed(T& target, T value)
+{
+    std::atomic_ref<T>(target).store(value, std::memory_order_relaxed);
+}
+
+template <typename T>
+T LoadRelaxed(const T& source)
+{
+    return std::atomic_ref<T>(const_cast<T&>(source)).load(std::memory_order_relaxed);
+}
+
+uint64_t Extent(uint32_t rows, uint32_t bits)
+{
+    return static_cast<uint64_t>(rows) << 32 | bits;
+}
+
+} // anonymous namespace
+
+DeltaEncoder::DeltaEncoder(size_t columns)
+    : previous_(columns)
+{
+}
+
+void DeltaEncoder::Reset(std::span<uint64_t> words)
+{
+    words_ = words;
+    rows_ = 0;
+    bits_ = 0;
+    prevTimestamp_ = 0;
+    prevDelta_ = 0;
+}
+
+void DeltaEncoder::Resume(std::span<uint64_t> words, uint32_t rows, uint32_t bits)
+{
+    Reset(words);
+    DeltaDecoder decoder(words, previous_.size());
+    for (uint32_t r = 0; r < rows; ++r) {
+        int64_t timestampMs = 0;
+        decoder.Next(timestampMs, previous_);
+        prevDelta_ = r > 0 ? timestampMs - prevTimestamp_ : 0;
+        prevTimestamp_ = timestampMs;
+    }
+    rows_ = rows;
+    bits_ = bits;
+}
+
+void DeltaEncoder::Write(uint64_t value, uint32_t bits)
+{
+    while (bits > 0) {
+        uint64_t& word = words_[bits_ / 64];
+        uint32_t used = bits_ % 64;
+        uint32_t take = std::min(64 - used, bits);
+        uint64_t chunk = value >> (bits - take);
+        if (take < 64)
+            chunk &= (1ULL << take) - 1;
+        chunk = take < 64 ? chunk << (64 - used - take) : chunk;
+        // A fresh word may still hold a reused block's bits
+        StoreRelaxed(word, used == 0 ? chunk : word | chunk);
+        bits_ += take;
+        bits -= take;
+    }
+}
+
+void DeltaEncoder::WriteClassed(int64_t value, std::span<const PrefixClass> classes)
+{
+    if (value == 0) {
+        Write(0, 1);
+        return;
+    }
+    uint64_t zz = ZigZag(value);
+    for (const auto& cls : classes) {
+        if (cls.payloadBits == 64 || zz < (1ULL << cls.payloadBits)) {
+            Write(cls.prefix, cls.prefixBits);
+            Write(zz, cls.payloadBits);
+            return;
+        }
+    }
+}
+
+bool DeltaEncoder::Append(int64_t timestampMs, std::span<const uint32_t> values)
+{
+    // Size the row first, so a row that does not fit leaves no partial bits behind
+    int64_t delta = timestampMs - prevTimestamp_;
+    size_t needed = 64 + 32 * previous_.size();
+    if (rows_ > 0) {
+        needed = ClassedBits(delta - prevDelta_, DodClasses);
+        for (size_t c = 0; c < previous_.size(); ++c)
+            needed += ClassedBits(static_cast<int32_t>(values[c] - previous_[c]), DeltaClasses);
+    }
+    if (bits_ + needed > words_.size() * 64)
+        return false;
+
+    if (rows_ == 0) {
+        Write(static_cast<uint64_t>(timestampMs), 64);
+        for (size_t c = 0; c < previous_.size(); ++c)
+            Write(values[c], 32);
+    }
+    else {
+        WriteClassed(delta - prevDelta_, DodClasses);
+        prevDelta_ = delta;
+        for (size_t c = 0; c < previous_.size(); ++c)
+            WriteClassed(static_cast<int32_t>(values[c] - previous_[c]), DeltaClasses);   // mod 2^32
+    }
+
+    std::copy_n(values.begin(), previous_.size(), previous_.begin());
+    prevTimestamp_ = timestampMs;
+    ++rows_;
+    return true;
+}
+
+DeltaDecoder::DeltaDecoder(std::span<const uint64_t> words, size_t columns)
+    : words_(words)
+    , previous_(columns)
+{
+}
+
+uint64_t DeltaDecoder::Read(uint32_t bits)
+{
+    uint64_t result = 0;
+    while (bits > 0) {
+        size_t offset = position_ % 64;
+        uint32_t take = std::min(static_cast<uint32_t>(64 - offset), bits);
+        uint64_t chunk = (words_[position_ / 64] << offset) >> (64 - take);
+        result = take < 64 ? (result << take) | chunk : chunk;
+        position_ += take;
+        bits -= take;
+    }
+    return result;
+}
+
+int64_t DeltaDecoder::ReadClassed(std::span<const DeltaEncoder::PrefixClass> classes)
+{
+    // The number of leading ones in the prefix selects the class; a 0 ends the prefix
+    uint32_t ones = 0;
+    while (ones < classes.size() && Read(1) == 1)
+        ++ones;
+    return ones > 0 ? UnZigZag(Read(classes[ones - 1].payloadBits)) : 0;
+}
+
+void DeltaDecoder::Next(int64_t& timestampMs, std::span<uint32_t> values)
+{
+    if (count_ == 0) {
+        prevTimestamp_ = static_cast<int64_t>(Read(64));
+        for (auto& value : previous_)
+            value = static_cast<uint32_t>(Read(32));
+    }
+    else {
+        prevDelta_ += ReadClassed(DodClasses);
+        prevTimestamp_ += prevDelta_;
+        for (auto& value : previous_)
+            value += static_cast<uint32_t>(ReadClassed(DeltaClasses));
+    }
+
+    std::copy(previous_.begin(), previous_.end(), values.begin());
+    timestampMs = prevTimestamp_;
+    ++count_;
+}
+
+CompressedSeries::CompressedSeries(size_t columns, size_t blockCount)
+    : columns_(columns)
+    , blockCount_(blockCount < 1 ? 1 : blockCount)
+    , ownedHeaders_(std::make_unique<BlockHeader[]>(blockCount_))
+    , ownedWords_(std::make_unique_for_overwrite<uint64_t[]>(blockCount_ * BlockWords))
+    , encoder_(columns)
+{
+    // Words are only read up to the bits a header publishes, so they need no zeroing
+    region_ = { ownedHeaders_.get(), ownedWords_.get() };
+}
+
+CompressedSeries::CompressedSeries(size_t columns, size_t blockCount, const Region& region)
+    : columns_(columns)
+    , blockCount_(blockCount < 1 ? 1 : blockCount)
+    , region_(region)
+    , encoder_(columns)
+{
+    Resume();
+}
+
+void CompressedSeries::Resume()
+{
+    // The newest block is the highest sequence whose header is consistent with its slot
+    uint64_t newest = 0;
+    for (size_t slot = 0; slot < blockCount_; ++slot) {
+        const BlockHeader& header = region_.headers[slot];
+        auto rows = static_cast<uint32_t>(header.extent >> 32);
+        auto bits = static_cast<uint32_t>(header.extent);
+        bool valid = header.sequence % blockCount_ == slot && rows > 0 && bits <= BlockWords * 64;
+        if (valid && header.sequence > newest)
+            newest = header.sequence;
+    }
+    if (newest == 0)
+        return;
+
+    const BlockHeader& header = HeaderOf(newest);
+    encoder_.Resume(WordsOf(newest), static_cast<uint32_t>(header.extent >> 32), static_cast<uint32_t>(header.extent));
+    next_.store(newest + 1);
+}
+
+void CompressedSeries::Append(int64_t timestampMs, std::span<const uint32_t> values)
+{
+    uint64_t newest = next_.load(std::memory_order_relaxed) - 1;
+    if (newest == 0 || !encoder_.Append(timestampMs, values)) {
+        StartBlock(timestampMs, values);
+        return;
+    }
+
+    BlockHeader& header = HeaderOf(newest);
+    StoreRelaxed(header.lastMs, timestampMs);
+    std::atomic_ref(header.extent).store(Extent(encoder_.Rows(), encoder_.Bits()), std::memory_order_release);
+}
+
+void CompressedSeries::StartBlock(int64_t timestampMs, std::span<const uint32_t> values)
+{
+    uint64_t sequence = next_.load(std::memory_order_relaxed);
+    BlockHeader& header = HeaderOf(sequence);
+
+    // Retire the oldest block before its words change; readers copying it see the
+    // sequence move and drop their copy
+    StoreRelaxed(header.sequence, uint64_t{ 0 });
+    std::atomic_thread_fence(std::memory_order_release);
+
+    encoder_.Reset(WordsOf(sequence));
+    encoder_.Append(timestampMs, values);   // a first row always fits
+    StoreRelaxed(header.firstMs, timestampMs);
+    StoreRelaxed(header.lastMs, timestampMs);
+    StoreRelaxed(header.extent, Extent(encoder_.Rows(), encoder_.Bits()));
+    std::atomic_ref(header.sequence).store(sequence, std::memory_order_release);
+    next_.store(sequence + 1, std::memory_order_release);
+}
+
+bool CompressedSeries::CopyBlock(uint64_t sequence, int64_t fromMs, std::vector<uint64_t>& words, BlockCopy& out) const
+{
+    const BlockHeader& header = HeaderOf(sequence);
+    if (std::atomic_ref(const_cast<uint64_t&>(header.sequence)).load(std::memory_order_acquire) != sequence)
+        return false;
+
+    uint64_t extent = std::atomic_ref(const_cast<uint64_t&>(header.extent)).load(std::memory_order_acquire);
+    out.rows = static_cast<uint32_t>(extent >> 32);
+    out.firstMs = LoadRelaxed(header.firstMs);
+    if (LoadRelaxed(header.lastMs) < fromMs)
+        return false;
+
+    auto bits = static_cast<uint32_t>(extent);
+    auto source = WordsOf(sequence);
+    words.resize((bits + 63) / 64);
+    for (size_t i = 0; i < words.size(); ++i)
+        words[i] = LoadRelaxed(source[i]);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return LoadRelaxed(header.sequence) == sequence;
+}
+
+size_t CompressedSeries::Size() const
+{
+    size_t rows = 0;
+    uint64_t next = next_.load(std::memory_order_relaxed);
+    for (uint64_t sequence = next > blockCount_ ? next - blockCount_ : 1; sequence < next; ++sequence)
+        rows += HeaderOf(sequence).extent >> 32;
+    return rows;
+}
+
+size_t CompressedSeries::EncodedBytes() const
+{
+    size_t bits = 0;
+    uint64_t next = next_.load(std::memory_order_relaxed);
+    for (uint64_t sequence = next > blockCount_ ? next - blockCount_ : 1; sequence < next; ++sequence)
+        bits += static_cast<uint32_t>(HeaderOf(sequence).extent);
+    return (bits + 7) / 8;
+}
+
+int64_t CompressedSeries::LatestTimestampMs() const
+{
+    uint64_t next = next_.load(std::memory_order_relaxed);
+    return next > 1 ? HeaderOf(next - 1).lastMs : std::numeric_limits<int64_t>::min();
+}
+
+} // namespace smc
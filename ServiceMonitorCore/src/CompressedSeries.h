@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace smc {
+
+/// Bit-packed encoder for rows of (timestamp, integer columns).
+/// Timestamps are stored as delta-of-delta and each column as the zigzag-coded
+/// difference from the previous row, both with variable-length prefixes. An unchanged
+/// column and a regular timestamp cost one bit each; small steps a few bits more.
+/// Columns hold fixed-point values (see FixedPointCodec), so the deltas are exact.
+/// Rows are written in place into a fixed-size block with atomic_ref stores, so a
+/// reader may copy the rows published so far while the writer appends more.
+class DeltaEncoder {
+public:
+    /// One variable-length class of a zigzag-coded number: prefix, prefix length and
+    /// payload bits. Zero is a single 0 bit; the last prefix is all ones, unterminated.
+    struct PrefixClass {
+        uint64_t prefix;
+        uint32_t prefixBits;
+        uint32_t payloadBits;
+    };
+
+    explicit DeltaEncoder(size_t columns);
+
+    /// Start an empty block in `words`.
+    void Reset(std::span<uint64_t> words);
+
+    /// Continue the block in `words` after its first `rows` rows (`bits` bits long),
+    /// decoding them to recover the previous row.
+    void Resume(std::span<uint64_t> words, uint32_t rows, uint32_t bits);
+
+    /// Append a row if it fits in the block; otherwise leave the block as it is and return false.
+    bool Append(int64_t timestampMs, std::span<const uint32_t> values);
+
+    uint32_t Rows() const { return rows_; }
+    uint32_t Bits() const { return bits_; }
+
+private:
+    void Write(uint64_t value, uint32_t bits);
+    void WriteClassed(int64_t value, std::span<const PrefixClass> classes);
+
+    std::span<uint64_t> words_;
+    std::vector<uint32_t> previous_;
+    uint32_t rows_ = 0;
+    uint32_t bits_ = 0;
+    int64_t prevTimestamp_ = 0;
+    int64_t prevDelta_ = 0;
+};
+
+/// Streaming decoder for one DeltaEncoder block.
+class DeltaDecoder {
+public:
+    DeltaDecoder(std::span<const uint64_t> words, size_t columns);
+
+    /// Decode the next row. The caller knows the row count; reading past it is undefined.
+    void Next(int64_t& timestampMs, std::span<uint32_t> values);
+
+private:
+    uint64_t Read(uint32_t bits);
+    int64_t ReadClassed(std::span<const DeltaEncoder::PrefixClass> classes);
+
+    std::span<const uint64_t> words_;
+    std::vector<uint32_t> previous_;
+    size_t position_ = 0;           // bit offset
+    size_t count_ = 0;
+    int64_t prevTimestamp_ = 0;
+    int64_t prevDelta_ = 0;
+};
+
+/// Append-only multi-column integer time series in a fixed number of blocks.
+/// Rows are DeltaEncoder-encoded straight into the newest block; when it is full the
+/// next block is started, reusing the oldest once all `blockCount` are in use, so
+/// retention is whatever fits in the blocks. With owned storage the blocks are
+/// allocated up front; with a caller-provided Region (e.g. a mapped file) they are
+/// used in place and the series resumes from the block headers.
+///
+/// Single writer: one thread calls Append(). ForEachInRange() may run on any thread at
+/// the same time and never blocks the writer: rows already in a block never change, so
+/// a reader copies a block and then checks that its header still carries the same
+/// sequence number. A block reused during the copy is skipped; it was the oldest.
+class CompressedSeries {
+public:
+    static constexpr size_t BlockWords = 128;   // 1 KiB of encoded rows per block
+
+    /// Per-block bookkeeping. `sequence` numbers blocks from 1 in write order, 0 marks
+    /// an empty slot; `extent` packs rows << 32 | bits so both are published at once.
+    struct BlockHeader {
+        uint64_t sequence = 0;
+        uint64_t extent = 0;
+        int64_t firstMs = 0;
+        int64_t lastMs = 0;
+    };
+
+    static constexpr size_t BlockBytes = sizeof(BlockHeader) + BlockWords * sizeof(uint64_t);
+
+    /// Externally owned storage: `blockCount` headers and blockCount * BlockWords words.
+    struct Region {
+        BlockHeader* headers = nullptr;
+        uint64_t* words = nullptr;
+    };
+
+    CompressedSeries(size_t columns, size_t blockCount);
+    CompressedSeries(size_t columns, size_t blockCount, const Region& region);
+
+    CompressedSeries(const CompressedSeries&) = delete;
+    CompressedSeries& operator=(const CompressedSeries&) = delete;
+
+    void Append(int64_t timestampMs, std::span<const uint32_t> values);
+
+    size_t Columns() const { return columns_; }
+    size_t BlockCount() const { return blockCount_; }
+
+    /// Bytes of block storage, fixed at construction.
+    size_t MemoryBytes() const { return blockCount_ * BlockBytes; }
+
+    /// Rows retained, their encoded size and the newest row's timestamp (INT64_MIN when
+    /// empty). Writer thread only.
+    size_t Size() const;
+    size_t EncodedBytes() const;
+    int64_t LatestTimestampMs() const;
+
+    /// Call fn(timestampMs, std::span<const uint32_t> values) for every row, oldest first,
+    /// decoding one block at a time.
+    template <typename Fn>
+    void ForEach(Fn&& fn) const
+    {
+        ForEachInRange(std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(), fn);
+    }
+
+    /// As ForEach(), for the rows with fromMs <= timestamp <= toMs. Timestamps must have
+    /// been appended in order; blocks ending before fromMs are skipped without decoding.
+    /// Safe to call from any thread while the writer appends.
+    template <typename Fn>
+    void ForEachInRange(int64_t fromMs, int64_t toMs, Fn&& fn) const
+    {
+        std::vector<uint64_t> words;
+        std::vector<uint32_t> row(columns_);
+        uint64_t next = next_.load(std::memory_order_acquire);
+        for (uint64_t sequence = next > blockCount_ ? next - blockCount_ : 1; sequence < next; ++sequence) {
+            BlockCopy block;
+            if (!CopyBlock(sequence, fromMs, words, block))
+                continue;
+            if (block.firstMs > toMs)
+                return;
+            DeltaDecoder decoder(words, columns_);
+            int64_t timestampMs = 0;
+            for (uint32_t r = 0; r < block.rows; ++r) {
+                decoder.Next(timestampMs, row);
+                if (timestampMs > toMs)
+                    return;
+                if (timestampMs >= fromMs)
+                    fn(timestampMs, std::span<const uint32_t>(row));
+            }
+        }
+    }
+
+private:
+    struct BlockCopy {
+        uint32_t rows = 0;
+        int64_t firstMs = 0;
+    };
+
+    /// Copy the rows published in block `sequence` into `words`. False if the block
+    /// is gone or was reused meanwhile, or ends before fromMs.
+    bool CopyBlock(uint64_t sequence, int64_t fromMs, std::vector<uint64_t>& words, BlockCopy& out) const;
+    void StartBlock(int64_t timestampMs, std::span<const uint32_t> values);
+    void Resume();
+    BlockHeader& HeaderOf(uint64_t sequence) const { return region_.headers[sequence % blockCount_]; }
+    std::span<uint64_t> WordsOf(uint64_t sequence) const
+    {
+        return { region_.words + (sequence % blockCount_) * BlockWords, BlockWords };
+    }
+
+    size_t columns_;
+    size_t blockCount_;
+    Region region_;                                 // points into the owned arrays unless externally owned
+    std::unique_ptr<BlockHeader[]> ownedHeaders_;
+    std::unique_ptr<uint64_t[]> ownedWords_;
+    std::atomic<uint64_t> next_{ 1 };               // sequence the next block will get
+    DeltaEncoder encoder_;
+};
+
+} // namespace smc
@@ -0,0 +1,118 @@
+#include "CpuBaselineTable.h"
+
+namespace smc {
+
+namespace {
+
+size_t RoundUpPow2(size_t value)
+{
+    size_t result = 16;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+} // anonymous namespace
+
+CpuBaselineTable::CpuBaselineTable(size_t initialCapacity, uint32_t maxAgeTicks)
+    : slots_(RoundUpPow2(initialCapacity))
+    , maxAge_(maxAgeTicks)
+{
+    mask_ = slots_.size() - 1;
+}
+
+size_t CpuBaselineTable::HomeIndex(ProcessId processId, uint64_t creationTime) const
+{
+    // 64-bit finalizer (murmur3 fmix64) over PID mixed with creation time
+    uint64_t h = (static_cast<uint64_t>(processId) * 0x9E3779B97F4A7C15ULL) ^ creationTime;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h) & mask_;
+}
+
+CpuBaselineTable::Baseline& CpuBaselineTable::Acquire(ProcessId processId, uint64_t creationTime, bool& inserted)
+{
+    if ((size_ + 1) * 10 > slots_.size() * 7)
+        Grow();
+
+    size_t index = HomeIndex(processId, creationTime);
+    for (;;) {
+        Slot& slot = slots_[index];
+        if (slot.processId == processId && slot.creationTime == creationTime) {
+            slot.lastSeen = generation_;
+            inserted = false;
+            return slot.baseline;
+        }
+        if (slot.processId == 0) {
+            slot.processId = processId;
+            slot.creationTime = creationTime;
+            slot.lastSeen = generation_;
+            slot.baseline = {};
+            ++size_;
+            inserted = true;
+            return slot.baseline;
+        }
+        index = (index + 1) & mask_;
+    }
+}
+
+void CpuBaselineTable::Sweep()
+{
+    ++generation_;
+    if (size_ == 0)
+        return;
+
+    // Backward-shift deletion only moves entries into the hole at `i` or later,
+    // so re-examining `i` after an erase visits every entry.
+    for (size_t i = 0; i < slots_.size();) {
+        const Slot& slot = slots_[i];
+        if (slot.processId != 0 && generation_ - slot.lastSeen > maxAge_) {
+            EraseAt(i);
+            continue;
+        }
+        ++i;
+    }
+}
+
+void CpuBaselineTable::EraseAt(size_t index)
+{
+    size_t hole = index;
+    size_t next = index;
+    for (;;) {
+        next = (next + 1) & mask_;
+        Slot& slot = slots_[next];
+        if (slot.processId == 0)
+            break;
+
+        // Move the entry back unless its home lies cyclically within (hole, next]
+        size_t home = HomeIndex(slot.processId, slot.creationTime);
+        bool stays = hole <= next ? (home > hole && home <= next)
+                                  : (home > hole || home <= next);
+        if (!stays) {
+            slots_[hole] = slot;
+            hole = next;
+        }
+    }
+
+    slots_[hole] = Slot{};
+    --size_;
+}
+
+void CpuBaselineTable::Grow()
+{
+    std::vector<Slot> old(slots_.size() * 2);
+    old.swap(slots_);
+    mask_ = slots_.size() - 1;
+
+    for (const Slot& slot : old) {
+        if (slot.processId == 0)
+            continue;
+        size_t index = HomeIndex(slot.processId, slot.creationTime);
+        while (slots_[index].processId != 0)
+            index = (index + 1) & mask_;
+        slots_[index] = slot;
+    }
+}
+
+} // namespace smc
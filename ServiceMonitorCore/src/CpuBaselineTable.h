@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ProcessBackend.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace smc {
+
+/// CPU baselines keyed by (PID, process creation time).
+/// Flat open-addressing table with linear probing: slots live in one contiguous
+/// array, inserts never allocate (the array only grows when load exceeds 70%),
+/// and Sweep() drops entries not touched in the last `maxAgeTicks` generations.
+/// Keying on creation time means a recycled PID starts from a fresh baseline.
+class CpuBaselineTable {
+public:
+    struct Baseline {
+        uint64_t lastTime = 0;
+        uint64_t lastCpu = 0;
+    };
+
+    explicit CpuBaselineTable(size_t initialCapacity = 512, uint32_t maxAgeTicks = 5);
+
+    /// Find or insert the baseline for a process and mark it seen in the current generation.
+    /// `inserted` is set when the entry is new.
+    Baseline& Acquire(ProcessId processId, uint64_t creationTime, bool& inserted);
+
+    /// Start a new generation and remove entries that have aged out.
+    void Sweep();
+
+    /// Change how many generations an untouched entry survives.
+    void SetMaxAge(uint32_t maxAgeTicks) { maxAge_ = maxAgeTicks; }
+
+    size_t Size() const { return size_; }
+    size_t Capacity() const { return slots_.size(); }
+
+private:
+    struct Slot {
+        ProcessId processId = 0;        // 0 marks an empty slot
+        uint32_t lastSeen = 0;
+        uint64_t creationTime = 0;
+        Baseline baseline;
+    };
+
+    size_t HomeIndex(ProcessId processId, uint64_t creationTime) const;
+    void EraseAt(size_t index);
+    void Grow();
+
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    uint32_t generation_ = 1;
+    uint32_t maxAge_ = 5;
+};
+
+} // namespace smc
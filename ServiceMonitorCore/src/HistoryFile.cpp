@@ -0,0 +1,343 @@
+#include "HistoryFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace smc {
+
+namespace {
+
+constexpr char Magic[8] = { 'S', 'M', 'C', 'H', 'I', 'S', 'T', '\0' };
+constexpr uint32_t Version = 2;        // 2: rollup tiers follow the raw ring
+constexpr size_t PageBytes = 4096;
+constexpr size_t MaxNameBytes = 248;
+
+constexpr size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+constexpr size_t RawBytes = 2 * sizeof(RingCursor)
+    + AlignUp(ServiceHistory::RawCapacity * sizeof(int64_t), 8)
+    + AlignUp(ServiceHistory::RawCapacity * sizeof(HistoryRing::CpuCodec::Stored), 8)
+    + AlignUp(ServiceHistory::RawCapacity * sizeof(HistoryRing::MemoryCodec::Stored), 8);
+
+constexpr size_t TierBytes(size_t blockCount)
+{
+    return blockCount * CompressedSeries::BlockBytes;
+}
+
+constexpr size_t RegionBytes = AlignUp(RawBytes
+                                       + TierBytes(ServiceHistory::TenSecondBlocks)
+                                       + TierBytes(ServiceHistory::OneMinuteBlocks),
+                                       PageBytes);
+
+CompressedSeries::Region TierAt(uint8_t*& cursor, size_t blockCount)
+{
+    CompressedSeries::Region tier;
+    tier.headers = reinterpret_cast<CompressedSeries::BlockHeader*>(cursor);
+    tier.words = reinterpret_cast<uint64_t*>(cursor + blockCount * sizeof(CompressedSeries::BlockHeader));
+    cursor += TierBytes(blockCount);
+    return tier;
+}
+
+} // anonymous namespace
+
+struct HistoryFile::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t capacity;
+    uint32_t tenSecondBlocks;
+    uint32_t oneMinuteBlocks;
+    uint32_t blockWords;
+    uint64_t regionBytes;
+    uint64_t fileBytes;
+};
+
+struct HistoryFile::SlotEntry {
+    uint32_t nameLength;            // 0 = free; written after the name
+    uint32_t reserved;
+    char name[MaxNameBytes];
+};
+
+static_assert(sizeof(HistoryRing::CpuCodec::Stored) <= 8 && sizeof(HistoryRing::MemoryCodec::Stored) <= 8);
+static_assert(sizeof(CompressedSeries::BlockHeader) % 8 == 0);
+
+HistoryFile::~HistoryFile()
+{
+    Close();
+}
+
+bool HistoryFile::Open(const std::filesystem::path& path, uint32_t slotCount)
+{
+    Close();
+
+    slotCount_ = slotCount;
+    regionBytes_ = RegionBytes;
+    size_t directoryBytes = AlignUp(slotCount * sizeof(SlotEntry), PageBytes);
+    fileBytes_ = PageBytes + directoryBytes + slotCount * regionBytes_;
+
+#ifdef _WIN32
+    // Exclusive: a second engine instance must not map the same rings
+    file_ = ::CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                          OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+        return false;
+#else
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        return false;
+    if (::flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+        Close();
+        return false;
+    }
+#endif
+
+    bool created = false;
+    if (!Map(fileBytes_, created)) {
+        Close();
+        return false;
+    }
+
+    if (!HeaderMatches()) {
+        // Different geometry or a torn first write: start over with a zeroed file
+        Unmap();
+        created = true;
+        if (!Map(fileBytes_, created)) {
+            Close();
+            return false;
+        }
+        Initialize();
+    }
+
+    acquired_.assign(slotCount_, 0);
+    slots_.clear();
+    for (uint32_t i = 0; i < slotCount_; ++i) {
+        const SlotEntry* slot = Slot(i);
+        if (slot->nameLength > 0 && slot->nameLength <= MaxNameBytes)
+            slots_.try_emplace(std::string(slot->name, slot->nameLength), i);
+    }
+    return true;
+}
+
+void HistoryFile::Close()
+{
+    Unmap();
+#ifdef _WIN32
+    if (file_ != INVALID_HANDLE_VALUE) {
+        ::CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
+    slots_.clear();
+    acquired_.clear();
+}
+
+bool HistoryFile::Map(size_t bytes, bool& created)
+{
+#ifdef _WIN32
+    LARGE_INTEGER size{};
+    ::GetFileSizeEx(file_, &size);
+    if (created || static_cast<uint64_t>(size.QuadPart) != bytes) {
+        // Truncating first guarantees the extended file reads as zeros
+        LARGE_INTEGER zero{};
+        LARGE_INTEGER target{};
+        target.QuadPart = static_cast<LONGLONG>(bytes);
+        if (!::SetFilePointerEx(file_, zero, nullptr, FILE_BEGIN) || !::SetEndOfFile(file_) ||
+            !::SetFilePointerEx(file_, target, nullptr, FILE_BEGIN) || !::SetEndOfFile(file_))
+            return false;
+        created = true;
+    }
+
+    mapping_ = ::CreateFileMappingW(file_, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    if (!mapping_)
+        return false;
+
+    base_ = static_cast<uint8_t*>(::MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, bytes));
+    return base_ != nullptr;
+#else
+    struct stat st{};
+    if (::fstat(fd_, &st) != 0)
+        return false;
+    if (created || static_cast<size_t>(st.st_size) != bytes) {
+        if (::ftruncate(fd_, 0) != 0 || ::ftruncate(fd_, static_cast<off_t>(bytes)) != 0)
+            return false;
+        created = true;
+    }
+
+    void* base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (base == MAP_FAILED)
+        return false;
+    base_ = static_cast<uint8_t*>(base);
+    return true;
+#endif
+}
+
+void HistoryFile::Unmap()
+{
+#ifdef _WIN32
+    if (base_)
+        ::UnmapViewOfFile(base_);
+    if (mapping_) {
+        ::CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+#else
+    if (base_)
+        ::munmap(base_, fileBytes_);
+#endif
+    base_ = nullptr;
+}
+
+void HistoryFile::Initialize()
+{
+    Header* header = HeaderPtr();
+    header->version = Version;
+    header->slotCount = slotCount_;
+    header->capacity = ServiceHistory::RawCapacity;
+    header->tenSecondBlocks = ServiceHistory::TenSecondBlocks;
+    header->oneMinuteBlocks = ServiceHistory::OneMinuteBlocks;
+    header->blockWords = CompressedSeries::BlockWords;
+    header->regionBytes = regionBytes_;
+    header->fileBytes = fileBytes_;
+
+    // The magic goes last, so a crash here leaves a file that is recreated next time
+    std::atomic_signal_fence(std::memory_order_release);
+    std::memcpy(header->magic, Magic, sizeof(Magic));
+    Flush();
+}
+
+bool HistoryFile::HeaderMatches() const
+{
+    const Header* header = HeaderPtr();
+    return std::memcmp(header->magic, Magic, sizeof(Magic)) == 0
+        && header->version == Version
+        && header->slotCount == slotCount_
+        && header->capacity == ServiceHistory::RawCapacity
+        && header->tenSecondBlocks == ServiceHistory::TenSecondBlocks
+        && header->oneMinuteBlocks == ServiceHistory::OneMinuteBlocks
+        && header->blockWords == CompressedSeries::BlockWords
+        && header->regionBytes == regionBytes_
+        && header->fileBytes == fileBytes_;
+}
+
+HistoryFile::Header* HistoryFile::HeaderPtr() const
+{
+    return reinterpret_cast<Header*>(base_);
+}
+
+HistoryFile::SlotEntry* HistoryFile::Slot(uint32_t index) const
+{
+    return reinterpret_cast<SlotEntry*>(base_ + PageBytes) + index;
+}
+
+ServiceHistory::Region HistoryFile::RegionFor(uint32_t index) const
+{
+    uint8_t* region = base_ + PageBytes + AlignUp(slotCount_ * sizeof(SlotEntry), PageBytes) + index * regionBytes_;
+    uint8_t* tiers = region + RawBytes;
+
+    ServiceHistory::Region result;
+    result.raw.cursors = reinterpret_cast<RingCursor*>(region);
+    region += 2 * sizeof(RingCursor);
+    result.raw.timestampsMs = reinterpret_cast<int64_t*>(region);
+    region += AlignUp(ServiceHistory::RawCapacity * sizeof(int64_t), 8);
+    result.raw.cpu = reinterpret_cast<HistoryRing::CpuCodec::Stored*>(region);
+    region += AlignUp(ServiceHistory::RawCapacity * sizeof(HistoryRing::CpuCodec::Stored), 8);
+    result.raw.memory = reinterpret_cast<HistoryRing::MemoryCodec::Stored*>(region);
+    result.tenSeconds = TierAt(tiers, ServiceHistory::TenSecondBlocks);
+    result.oneMinute = TierAt(tiers, ServiceHistory::OneMinuteBlocks);
+    return result;
+}
+
+int64_t HistoryFile::LatestTimestamp(uint32_t index) const
+{
+    HistoryRing ring(ServiceHistory::RawCapacity, RegionFor(index).raw);
+    return ring.Empty() ? INT64_MIN : ring.LatestTimestampMs();
+}
+
+int64_t HistoryFile::LatestTimestampMs() const
+{
+    int64_t latest = INT64_MIN;
+    for (const auto& [name, index] : slots_)
+        latest = std::max(latest, LatestTimestamp(index));
+    return latest;
+}
+
+bool HistoryFile::Acquire(const std::string& name, ServiceHistory::Region& region)
+{
+    if (!base_ || name.empty() || name.size() > MaxNameBytes)
+        return false;
+
+    auto it = slots_.find(name);
+    if (it != slots_.end()) {
+        acquired_[it->second] = 1;
+        region = RegionFor(it->second);
+        return true;
+    }
+
+    // Prefer a free slot, otherwise evict the stalest slot nobody holds
+    uint32_t victim = UINT32_MAX;
+    int64_t oldest = INT64_MAX;
+    for (uint32_t i = 0; i < slotCount_; ++i) {
+        if (acquired_[i])
+            continue;
+        if (Slot(i)->nameLength == 0) {
+            victim = i;
+            break;
+        }
+        int64_t latest = LatestTimestamp(i);
+        if (latest < oldest) {
+            oldest = latest;
+            victim = i;
+        }
+    }
+    if (victim == UINT32_MAX)
+        return false;
+
+    SlotEntry* slot = Slot(victim);
+    if (slot->nameLength > 0)
+        slots_.erase(std::string(slot->name, slot->nameLength));
+
+    // Release the slot, reset its ring and tiers, then publish the new name
+    slot->nameLength = 0;
+    region = RegionFor(victim);
+    std::fill_n(region.raw.cursors, 2, RingCursor{});
+    std::fill_n(region.tenSeconds.headers, ServiceHistory::TenSecondBlocks, CompressedSeries::BlockHeader{});
+    std::fill_n(region.oneMinute.headers, ServiceHistory::OneMinuteBlocks, CompressedSeries::BlockHeader{});
+    std::memcpy(slot->name, name.data(), name.size());
+    std::atomic_signal_fence(std::memory_order_release);
+    slot->nameLength = static_cast<uint32_t>(name.size());
+
+    slots_.emplace(name, victim);
+    acquired_[victim] = 1;
+    return true;
+}
+
+void HistoryFile::Flush()
+{
+    if (!base_)
+        return;
+#ifdef _WIN32
+    ::FlushViewOfFile(base_, 0);
+#else
+    ::msync(base_, fileBytes_, MS_ASYNC);
+#endif
+}
+
+} // namespace smc
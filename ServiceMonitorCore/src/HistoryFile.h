@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ServiceHistory.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+
+namespace smc {
+
+/// Memory-mapped file holding one ServiceHistory region per service, so history at
+/// every resolution survives engine restarts and is usable the moment the file is mapped.
+/// Layout: a fixed header, a directory of `slotCount` service names, then one region
+/// per slot: the raw ring (two RingCursor copies followed by the timestamp, CPU and
+/// memory columns), then the block headers and words of the 10 s and 1 min tiers.
+/// Samples and cursors are plain stores into the mapping; the OS writes dirty pages back.
+/// A file whose header does not match the requested geometry is recreated empty.
+/// Not thread-safe; the owner serializes access.
+class HistoryFile {
+public:
+    HistoryFile() = default;
+    ~HistoryFile();
+
+    HistoryFile(const HistoryFile&) = delete;
+    HistoryFile& operator=(const HistoryFile&) = delete;
+
+    /// Map (creating if needed) the file, sized for ServiceHistory's tiers. Returns false
+    /// if it cannot be opened or locked.
+    bool Open(const std::filesystem::path& path, uint32_t slotCount);
+    void Close();
+    bool IsOpen() const { return base_ != nullptr; }
+
+    /// Newest sample time across every stored region, INT64_MIN if there is none.
+    int64_t LatestTimestampMs() const;
+
+    /// Region for a service, claiming a free slot (or the least recently written slot not
+    /// in use) if it has none. Returns false when every slot is in use. Stored regions
+    /// are not held until acquired, so slots of services that never return are reclaimed.
+    bool Acquire(const std::string& name, ServiceHistory::Region& region);
+
+    /// Ask the OS to start writing dirty pages back. Not needed for crash safety of the
+    /// process, only to narrow the window on power loss.
+    void Flush();
+
+private:
+    struct Header;
+    struct SlotEntry;
+
+    bool Map(size_t bytes, bool& created);
+    void Unmap();
+    void Initialize();
+    bool HeaderMatches() const;
+
+    Header* HeaderPtr() const;
+    SlotEntry* Slot(uint32_t index) const;
+    ServiceHistory::Region RegionFor(uint32_t index) const;
+    int64_t LatestTimestamp(uint32_t index) const;
+
+    uint32_t slotCount_ = 0;
+    size_t regionBytes_ = 0;
+    size_t fileBytes_ = 0;
+    uint8_t* base_ = nullptr;
+    std::unordered_map<std::string, uint32_t> slots_;
+    std::vector<uint8_t> acquired_;     // slots handed out by this process
+
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+} // namespace smc
@@ -0,0 +1,221 @@
+#include "HistoryRing.h"
+
+#include <atomic>
+
+namespace smc {
+
+namespace {
+
+uint64_t CursorChecksum(const RingCursor& cursor)
+{
+    // Never zero for a zero-filled cursor, so fresh storage reads as empty
+    uint64_t h = 0x5348495354525947ULL;
+    for (uint64_t v : { cursor.sequence, cursor.head, cursor.size }) {
+        h ^= v + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+        h *= 0xFF51AFD7ED558CCDULL;
+    }
+    return h;
+}
+
+template <typename T>
+void StoreRelaxed(T& target, T value)
+{
+    std::atomic_ref<T>(target).store(value, std::memory_order_relaxed);
+}
+
+template <typename T>
+T LoadRelaxed(const T& source)
+{
+    return std::atomic_ref<T>(const_cast<T&>(source)).load(std::memory_order_relaxed);
+}
+
+} // anonymous namespace
+
+HistoryRing::HistoryRing(size_t capacity)
+    : capacity_(capacity < 1 ? 1 : capacity)
+{
+}
+
+HistoryRing::HistoryRing(size_t capacity, const Region& region)
+    : capacity_(capacity < 1 ? 1 : capacity)
+    , allocated_(capacity_)
+    , region_(region)
+{
+    LoadCursor();
+}
+
+void HistoryRing::Push(int64_t timestampMs, double cpuPercent, double memoryMB)
+{
+    // Readers that could still hold retired pointers registered before the swap
+    if (!retired_.empty() && readers_.load() == 0)
+        retired_.clear();
+
+    if (head_ == allocated_)
+        Grow();
+
+    // A clock stepped back between runs must not unsort the persisted column
+    if (size_ > 0)
+        timestampMs = std::max(timestampMs, LatestTimestampMs());
+
+    BeginWrite();
+    StoreRelaxed(region_.timestampsMs[head_], timestampMs);
+    StoreRelaxed(region_.cpu[head_], CpuCodec::Encode(cpuPercent));
+    StoreRelaxed(region_.memory[head_], MemoryCodec::Encode(memoryMB));
+    StoreRelaxed(head_, (head_ + 1) % capacity_);
+    if (size_ < capacity_)
+        StoreRelaxed(size_, size_ + 1);
+    EndWrite();
+
+    if (region_.cursors)
+        PublishCursor();
+}
+
+void HistoryRing::Grow()
+{
+    // Warm-up with owned storage: grow geometrically, but never past capacity
+    size_t allocated = std::min(capacity_, std::max<size_t>(64, allocated_ * 2));
+    Storage grown = owned_;
+    grown.timestampsMs.resize(allocated);
+    grown.cpu.resize(allocated);
+    grown.memory.resize(allocated);
+
+    BeginWrite();
+    StoreRelaxed(region_.timestampsMs, grown.timestampsMs.data());
+    StoreRelaxed(region_.cpu, grown.cpu.data());
+    StoreRelaxed(region_.memory, grown.memory.data());
+    StoreRelaxed(allocated_, allocated);
+    EndWrite();
+
+    // Moving a vector keeps its buffer, so region_ stays valid
+    retired_.push_back(std::move(owned_));
+    owned_ = std::move(grown);
+}
+
+void HistoryRing::BeginWrite()
+{
+    version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void HistoryRing::EndWrite()
+{
+    // seq_cst, so Push() reading readers_ == 0 afterwards proves no reader saw the old state
+    version_.store(version_.load(std::memory_order_relaxed) + 1);
+}
+
+void HistoryRing::LoadCursor()
+{
+    const RingCursor* best = nullptr;
+    for (int i = 0; i < 2; ++i) {
+        const RingCursor& cursor = region_.cursors[i];
+        bool valid = cursor.checksum == CursorChecksum(cursor)
+            && cursor.head < capacity_ && cursor.size <= capacity_;
+        if (valid && (!best || cursor.sequence > best->sequence))
+            best = &cursor;
+    }
+
+    if (best) {
+        sequence_ = best->sequence;
+        head_ = static_cast<size_t>(best->head);
+        size_ = static_cast<size_t>(best->size);
+    }
+}
+
+void HistoryRing::PublishCursor()
+{
+    // Samples must land before the cursor that covers them
+    std::atomic_signal_fence(std::memory_order_release);
+
+    ++sequence_;
+    RingCursor& cursor = region_.cursors[sequence_ & 1];
+    cursor.sequence = sequence_;
+    cursor.head = head_;
+    cursor.size = size_;
+    std::atomic_signal_fence(std::memory_order_release);
+    cursor.checksum = CursorChecksum(cursor);
+}
+
+std::array<HistoryRing::Segment, 2> HistoryRing::Segments() const
+{
+    if (size_ == 0)
+        return {};
+
+    std::span<const int64_t> ts(region_.timestampsMs, allocated_);
+    std::span<const CpuCodec::Stored> cpu(region_.cpu, allocated_);
+    std::span<const MemoryCodec::Stored> memory(region_.memory, allocated_);
+
+    // Oldest sample sits at head_ - size_ (mod capacity)
+    size_t oldest = (head_ + capacity_ - size_) % capacity_;
+    size_t firstCount = std::min(size_, capacity_ - oldest);
+    return {
+        Segment{ ts.subspan(oldest, firstCount), cpu.subspan(oldest, firstCount), memory.subspan(oldest, firstCount) },
+        Segment{ ts.first(size_ - firstCount), cpu.first(size_ - firstCount), memory.first(size_ - firstCount) },
+    };
+}
+
+std::array<HistoryRing::Segment, 2> HistoryRing::Range(int64_t fromMs, int64_t toMs) const
+{
+    auto segments = Segments();
+    for (auto& segment : segments) {
+        auto ts = segment.timestampsMs;
+        size_t first = std::lower_bound(ts.begin(), ts.end(), fromMs) - ts.begin();
+        size_t last = std::upper_bound(ts.begin() + first, ts.end(), toMs) - ts.begin();
+        segment = Segment{ ts.subspan(first, last - first),
+                           segment.cpu.subspan(first, last - first),
+                           segment.memory.subspan(first, last - first) };
+    }
+    return segments;
+}
+
+void HistoryRing::CopyRange(int64_t fromMs, int64_t toMs, Samples& out) const
+{
+    readers_.fetch_add(1);
+    for (;;) {
+        out.Clear();
+        uint64_t version = version_.load();
+        if (version & 1)
+            continue;
+
+        const int64_t* timestamps = LoadRelaxed(region_.timestampsMs);
+        const CpuCodec::Stored* cpu = LoadRelaxed(region_.cpu);
+        const MemoryCodec::Stored* memory = LoadRelaxed(region_.memory);
+        size_t head = LoadRelaxed(head_);
+        size_t size = LoadRelaxed(size_);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (version_.load(std::memory_order_relaxed) != version)
+            continue;
+
+        // The layout is now consistent and its storage stays alive, so indexing is in
+        // bounds; torn sample values are caught by the version check at the end
+        size_t oldest = (head + capacity_ - size) % capacity_;
+        auto timestampAt = [&](size_t i) { return LoadRelaxed(timestamps[(oldest + i) % capacity_]); };
+        size_t first = 0;
+        for (size_t count = size; count > 0;) {
+            size_t step = count / 2;
+            if (timestampAt(first + step) < fromMs) {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else {
+                count = step;
+            }
+        }
+
+        for (size_t i = first; i < size; ++i) {
+            int64_t timestampMs = timestampAt(i);
+            if (timestampMs > toMs)
+                break;
+            size_t slot = (oldest + i) % capacity_;
+            out.timestampsMs.push_back(timestampMs);
+            out.cpu.push_back(CpuCodec::Decode(LoadRelaxed(cpu[slot])));
+            out.memory.push_back(MemoryCodec::Decode(LoadRelaxed(memory[slot])));
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (version_.load(std::memory_order_relaxed) == version)
+            break;
+    }
+    readers_.fetch_sub(1);
+}
+
+} // namespace smc
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace smc {
+
+/// Column storage formats. Each codec maps a double to a compact stored value and back.
+struct Float32Codec {
+    using Stored = float;
+    static Stored Encode(double value) { return static_cast<float>(value); }
+    static double Decode(Stored stored) { return stored; }
+};
+
+/// Unsigned fixed point with `Scale` steps per unit, saturating at the type's range.
+/// FixedPointCodec<100> stores a CPU percentage to 0.01 in 16 bits.
+template <uint32_t Scale, typename T = uint16_t>
+struct FixedPointCodec {
+    using Stored = T;
+    static Stored Encode(double value)
+    {
+        double scaled = std::round(value * Scale);
+        scaled = std::clamp(scaled, 0.0, static_cast<double>(std::numeric_limits<T>::max()));
+        return static_cast<Stored>(scaled);
+    }
+    static double Decode(Stored stored) { return static_cast<double>(stored) / Scale; }
+};
+
+/// Write position of a HistoryRing kept in external storage. Two copies alternate
+/// by sequence number and each carries a checksum, so a crash part-way through an
+/// update leaves the previous copy intact.
+struct RingCursor {
+    uint64_t sequence = 0;
+    uint64_t head = 0;
+    uint64_t size = 0;
+    uint64_t checksum = 0;
+};
+
+/// Fixed-capacity ring of per-service samples, one contiguous array per column
+/// (struct of arrays). With owned storage the columns grow to `capacity` while
+/// warming up; with a caller-provided Region (e.g. a mapped file) they are used in
+/// place and the ring resumes from the region's cursor. After warm-up Push()
+/// overwrites the oldest sample in O(1) and never allocates or makes a system call.
+/// Timestamps are kept non-decreasing, so time ranges are found by binary search.
+///
+/// Single writer: one thread calls Push(). CopyRange() may run on any thread at the
+/// same time; it is a seqlock reader that retries if a Push() overlapped the copy and
+/// never blocks the writer. Every other accessor is for the writer thread only.
+class HistoryRing {
+public:
+    using CpuCodec = FixedPointCodec<100>;      // percent, 0.01 resolution
+    using MemoryCodec = Float32Codec;           // MB
+
+    /// Column bytes per sample.
+    static constexpr size_t SampleBytes = sizeof(int64_t) + sizeof(CpuCodec::Stored) + sizeof(MemoryCodec::Stored);
+
+    /// Externally owned column arrays of `capacity` entries plus two cursor copies.
+    struct Region {
+        int64_t* timestampsMs = nullptr;
+        CpuCodec::Stored* cpu = nullptr;
+        MemoryCodec::Stored* memory = nullptr;
+        RingCursor* cursors = nullptr;
+    };
+
+    /// One contiguous run of samples. Index i of every column is the same sample.
+    struct Segment {
+        std::span<const int64_t> timestampsMs;
+        std::span<const CpuCodec::Stored> cpu;
+        std::span<const MemoryCodec::Stored> memory;
+    };
+
+    /// Decoded samples, as copied out by CopyRange().
+    struct Samples {
+        std::vector<int64_t> timestampsMs;
+        std::vector<double> cpu;
+        std::vector<double> memory;
+
+        size_t Size() const { return timestampsMs.size(); }
+        void Clear()
+        {
+            timestampsMs.clear();
+            cpu.clear();
+            memory.clear();
+        }
+    };
+
+    explicit HistoryRing(size_t capacity);
+    HistoryRing(size_t capacity, const Region& region);
+
+    HistoryRing(const HistoryRing&) = delete;
+    HistoryRing& operator=(const HistoryRing&) = delete;
+
+    void Push(int64_t timestampMs, double cpuPercent, double memoryMB);
+
+    size_t Size() const { return size_; }
+    size_t Capacity() const { return capacity_; }
+    bool Empty() const { return size_ == 0; }
+
+    /// The samples oldest first, as at most two runs (the second is empty unless the ring has wrapped).
+    std::array<Segment, 2> Segments() const;
+
+    /// The samples with fromMs <= timestamp <= toMs, oldest first, as in Segments().
+    std::array<Segment, 2> Range(int64_t fromMs, int64_t toMs) const;
+
+    /// Replace `out` with the samples with fromMs <= timestamp <= toMs, oldest first.
+    /// Safe to call from any thread while the writer pushes.
+    void CopyRange(int64_t fromMs, int64_t toMs, Samples& out) const;
+
+    /// Newest sample, decoded. The ring must not be empty.
+    int64_t LatestTimestampMs() const { return region_.timestampsMs[Newest()]; }
+    double LatestCpu() const { return CpuCodec::Decode(region_.cpu[Newest()]); }
+    double LatestMemory() const { return MemoryCodec::Decode(region_.memory[Newest()]); }
+
+    /// Call fn(timestampMs, cpuPercent, memoryMB) for every sample, oldest first.
+    template <typename Fn>
+    void ForEach(Fn&& fn) const
+    {
+        for (const auto& segment : Segments()) {
+            for (size_t i = 0; i < segment.timestampsMs.size(); ++i)
+                fn(segment.timestampsMs[i], CpuCodec::Decode(segment.cpu[i]), MemoryCodec::Decode(segment.memory[i]));
+        }
+    }
+
+private:
+    struct Storage {
+        std::vector<int64_t> timestampsMs;
+        std::vector<CpuCodec::Stored> cpu;
+        std::vector<MemoryCodec::Stored> memory;
+    };
+
+    size_t Newest() const { return (head_ + capacity_ - 1) % capacity_; }
+    void Grow();
+    void LoadCursor();
+    void PublishCursor();
+    void BeginWrite();
+    void EndWrite();
+
+    // head_, size_, allocated_ and the region_ pointers are shared with CopyRange():
+    // the writer stores them with atomic_ref inside BeginWrite()/EndWrite()
+    size_t capacity_;
+    size_t head_ = 0;       // next slot to write
+    size_t size_ = 0;
+    size_t allocated_ = 0;  // writable slots in region_
+    uint64_t sequence_ = 0;
+    Region region_;         // points into owned_ unless externally owned
+    Storage owned_;
+    std::vector<Storage> retired_;              // outgrown warm-up storage, freed once no reader is active
+    std::atomic<uint64_t> version_{ 0 };        // odd while the writer is changing the ring
+    mutable std::atomic<uint32_t> readers_{ 0 };
+};
+
+} // namespace smc
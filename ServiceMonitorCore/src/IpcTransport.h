@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace smc {
+
+/// Base of what a handler keeps about a push subscription (see IpcSession::subscription).
+struct IpcSubscription {
+    virtual ~IpcSubscription() = default;
+};
+
+/// What the request handler keeps about a client between its requests, such as the
+/// encoding it negotiated. Reset for each new client; only the thread serving the
+/// client's current request touches it.
+struct IpcSession {
+    bool binaryFrames = false;          // responses are wire frames (see WireFormat.h), not JSON text
+    std::vector<bool> namesSent;        // by ServiceId: the name went out in a frame's name table
+
+    /// Set by the handler when its response goes out as several messages. PipeServer sends
+    /// the handler's return value, then calls this after each write: it fills `message` and
+    /// returns true to send another, or false once the response is complete. The client's
+    /// next request is read only then.
+    std::function<bool(IpcSession& session, std::string& message)> nextMessage;
+
+    /// Set by the handler to make the connection a push stream: after the reply, no more
+    /// requests are read and PipeServer::Push() offers the session each message published.
+    std::unique_ptr<IpcSubscription> subscription;
+};
+
+/// One client connection. Transports derive from it to add their handle and I/O state;
+/// PipeServer pools the objects and reuses them across clients.
+struct IpcConnection {
+    enum class Op { Accept, Read, Write };
+
+    virtual ~IpcConnection() = default;
+
+    Op op = Op::Accept;                 // last operation started, set by PipeServer
+    std::vector<char> buffer;           // Read() fills it with one message, or the next piece of one
+    std::string request;                // pieces of the message being reassembled, set by PipeServer
+    std::string response;               // Write() sends it as one message
+    std::shared_ptr<const std::string> pushed;  // when set, Write() sends this instead
+    IpcSession session;
+    std::mutex ioMutex;                 // held by PipeServer while starting or cancelling I/O
+
+    // Push streams, managed by PipeServer under pushMutex
+    bool subscribed = false;            // listed as a subscriber
+    bool pushing = false;               // a write is in flight
+    std::deque<std::shared_ptr<const std::string>> pushQueue;   // waiting for that write
+    std::mutex pushMutex;
+
+    /// The message Write() sends.
+    const std::string& Outgoing() const { return pushed ? *pushed : response; }
+};
+
+/// A finished operation, as returned by IpcTransport::Wait().
+struct IpcCompletion {
+    IpcConnection* connection = nullptr;
+    bool ok = false;
+    size_t bytes = 0;                   // bytes read into the buffer, or written
+    bool more = false;                  // a read filled the buffer and the message continues
+};
+
+/// Message-oriented endpoint under PipeServer, in the style of an I/O completion port:
+/// operations are started on a connection and finish later as a completion returned by
+/// Wait(), which several I/O threads call concurrently. At most one operation is in
+/// flight per connection. Every operation that started, cancelled or not, yields exactly
+/// one completion; a start function returning false yields none.
+class IpcTransport {
+public:
+    static constexpr size_t MessageBufferBytes = 4096;          // read size; longer messages take several
+    static constexpr size_t PipeBufferBytes = 64 * 1024;        // kernel buffering per direction, a hint
+    static constexpr size_t MaxMessageBytes = 1024 * 1024;      // longer requests drop the client
+
+    virtual ~IpcTransport() = default;
+
+    /// Open the endpoint `name`. Returns false if it cannot be created.
+    virtual bool Listen(const std::wstring& name) = 0;
+
+    /// Close the endpoint. No operation may be in flight.
+    virtual void Close() = 0;
+
+    virtual std::unique_ptr<IpcConnection> CreateConnection() = 0;
+
+    /// Wait for the next client on `conn`.
+    virtual bool Accept(IpcConnection& conn) = 0;
+
+    /// Read a message into conn.buffer. If it does not fit, the read completes with `more`
+    /// set and the next Read() continues the same message.
+    virtual bool Read(IpcConnection& conn) = 0;
+
+    /// Send conn.Outgoing() as one message.
+    virtual bool Write(IpcConnection& conn) = 0;
+
+    /// Abort the operation in flight on `conn`, which then completes with ok == false.
+    /// Does nothing if none is in flight.
+    virtual void Cancel(IpcConnection& conn) = 0;
+
+    /// Drop the client of `conn`; the object can then Accept() the next one.
+    virtual void Disconnect(IpcConnection& conn) = 0;
+
+    /// Block until an operation completes. Returns false when woken by Wake() instead.
+    virtual bool Wait(IpcCompletion& completion) = 0;
+
+    /// Make `count` Wait() calls return false.
+    virtual void Wake(size_t count) = 0;
+};
+
+/// Create the transport for the platform this binary was built for: message-mode
+/// Named Pipes on Windows, AF_UNIX SOCK_SEQPACKET sockets elsewhere.
+std::unique_ptr<IpcTransport> CreateIpcTransport();
+
+} // namespace smc
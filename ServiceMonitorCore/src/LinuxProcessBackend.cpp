@@ -0,0 +1,144 @@
+#include "LinuxProcessBackend.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace smc {
+
+namespace {
+
+constexpr uint64_t TicksPer100ns = 10'000'000ULL;
+
+uint64_t BootTime100ns()
+{
+    timespec ts{};
+    ::clock_gettime(CLOCK_BOOTTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * TicksPer100ns + static_cast<uint64_t>(ts.tv_nsec) / 100;
+}
+
+/// Advance past `count` space-separated fields.
+const char* SkipFields(const char* p, int count)
+{
+    while (count-- > 0 && p) {
+        p = std::strchr(p, ' ');
+        if (p) ++p;
+    }
+    return p;
+}
+
+} // anonymous namespace
+
+std::unique_ptr<ProcessBackend> CreateProcessBackend()
+{
+    return std::make_unique<LinuxProcessBackend>();
+}
+
+LinuxProcessBackend::LinuxProcessBackend()
+{
+    long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+    numProcessors_ = cpus > 0 ? static_cast<int>(cpus) : 1;
+
+    long ticks = ::sysconf(_SC_CLK_TCK);
+    if (ticks > 0) ticksPerSecond_ = static_cast<uint64_t>(ticks);
+
+    long page = ::sysconf(_SC_PAGESIZE);
+    if (page > 0) pageSize_ = static_cast<uint64_t>(page);
+}
+
+long LinuxProcessBackend::ReadProcFile(const char* path, Buffer& buffer)
+{
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    ssize_t n = ::read(fd, buffer.data(), buffer.size() - 1);
+    ::close(fd);
+    if (n <= 0)
+        return -1;
+
+    buffer[static_cast<size_t>(n)] = '\0';
+    return static_cast<long>(n);
+}
+
+bool LinuxProcessBackend::Sample(ProcessId processId, ProcessSample& sample)
+{
+    // Per-call buffer so concurrent samplers never share state
+    Buffer buffer;
+    return ReadProcess(processId, BootTime100ns(), sample, buffer);
+}
+
+bool LinuxProcessBackend::SampleAll(std::vector<ProcessSample>& samples)
+{
+    samples.clear();
+
+    DIR* proc = ::opendir("/proc");
+    if (!proc)
+        return false;
+
+    uint64_t now = BootTime100ns();
+    ProcessSample sample{};
+
+    while (dirent* entry = ::readdir(proc)) {
+        if (entry->d_name[0] < '1' || entry->d_name[0] > '9')
+            continue;
+
+        char* end = nullptr;
+        unsigned long pid = std::strtoul(entry->d_name, &end, 10);
+        if (*end != '\0')
+            continue;
+
+        // Processes may exit between readdir and open; just skip them
+        if (ReadProcess(static_cast<ProcessId>(pid), now, sample, buffer_))
+            samples.push_back(sample);
+    }
+
+    ::closedir(proc);
+    return true;
+}
+
+bool LinuxProcessBackend::ReadProcess(ProcessId processId, uint64_t sampleTime, ProcessSample& sample, Buffer& buffer) const
+{
+    char path[64];
+
+    std::snprintf(path, sizeof(path), "/proc/%u/stat", processId);
+    if (ReadProcFile(path, buffer) < 0)
+        return false;
+
+    sample = {};
+    sample.processId = processId;
+    sample.sampleTime = sampleTime;
+
+    // The comm field may contain spaces and parentheses; fields resume after the last ')'.
+    // Field 3 (state) follows it, then utime/stime are fields 14/15 and starttime is field 22.
+    if (const char* close = std::strrchr(buffer.data(), ')')) {
+        const char* utimeField = SkipFields(close + 2, 11);
+        if (utimeField) {
+            char* end = nullptr;
+            uint64_t utime = std::strtoull(utimeField, &end, 10);
+            uint64_t stime = std::strtoull(end, &end, 10);
+            const char* startField = SkipFields(end + 1, 6);
+            if (startField) {
+                uint64_t start = std::strtoull(startField, nullptr, 10);
+                sample.cpuTime = (utime + stime) * TicksPer100ns / ticksPerSecond_;
+                sample.creationTime = start * TicksPer100ns / ticksPerSecond_;
+            }
+        }
+    }
+
+    std::snprintf(path, sizeof(path), "/proc/%u/statm", processId);
+    if (ReadProcFile(path, buffer) > 0) {
+        const char* resident = SkipFields(buffer.data(), 1);
+        if (resident)
+            sample.workingSetBytes = std::strtoull(resident, nullptr, 10) * pageSize_;
+    }
+
+    return true;
+}
+
+} // namespace smc
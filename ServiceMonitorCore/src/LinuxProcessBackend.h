@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ProcessBackend.h"
+
+#include <array>
+
+namespace smc {
+
+/// ProcessBackend reading /proc/<pid>/stat and /proc/<pid>/statm.
+/// Times are CLOCK_BOOTTIME-based (100 ns since boot), so uptime and CPU deltas
+/// match the Win32 backend's semantics.
+class LinuxProcessBackend : public ProcessBackend {
+public:
+    LinuxProcessBackend();
+
+    int ProcessorCount() const override { return numProcessors_; }
+    bool Sample(ProcessId processId, ProcessSample& sample) override;
+
+    /// One sweep over /proc, reusing the read buffer for every process.
+    bool SampleAll(std::vector<ProcessSample>& samples) override;
+
+private:
+    using Buffer = std::array<char, 4096>;
+
+    bool ReadProcess(ProcessId processId, uint64_t sampleTime, ProcessSample& sample, Buffer& buffer) const;
+
+    /// Read a small /proc file into `buffer`. Returns the number of bytes read, or -1.
+    static long ReadProcFile(const char* path, Buffer& buffer);
+
+    int numProcessors_ = 1;
+    uint64_t ticksPerSecond_ = 100;
+    uint64_t pageSize_ = 4096;
+    Buffer buffer_{};                   // reused by SampleAll()
+};
+
+} // namespace smc
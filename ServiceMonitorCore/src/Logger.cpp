@@ -53,7 +53,11 @@ void Logger::WriteUnlocked(const std::wstring& level, const std::wstring& messag
     auto now = std::chrono::system_clock::now();
     auto time = std::chrono::system_clock::to_time_t(now);
     std::tm tm{};
+#ifdef _WIN32
     localtime_s(&tm, &time);
+#else
+    localtime_r(&time, &tm);
+#endif
 
     wchar_t timeBuf[32];
     wcsftime(timeBuf, sizeof(timeBuf) / sizeof(wchar_t), L"%Y-%m-%d %H:%M:%S", &tm);
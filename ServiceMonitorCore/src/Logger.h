@@ -5,10 +5,6 @@
 #include <mutex>
 #include <filesystem>
 #include <chrono>
-#include <format>
-
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
 
 namespace smc {
 
@@ -1,8 +1,15 @@
 #include "MonitorService.h"
 #include "JsonProtocol.h"
 #include "Logger.h"
+#include "WireFormat.h"
 
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <span>
 #include <sstream>
+#include <unordered_map>
+#include <utility>
 
 namespace smc {
 
@@ -28,47 +35,117 @@ std::wstring Utf8ToWide(const std::string& utf8)
     return result;
 }
 
-/// Enumerate all running Win32 services and return their names.
-std::vector<std::wstring> GetRunningServiceNames()
+int64_t WallClockMs()
 {
-    std::vector<std::wstring> names;
-    SC_HANDLE hScm = ::OpenSCManagerW(nullptr, nullptr, SC_MANAGER_ENUMERATE_SERVICE);
-    if (!hScm) return names;
-
-    DWORD bytesNeeded = 0, serviceCount = 0, resumeHandle = 0;
-    ::EnumServicesStatusExW(hScm, SC_ENUM_PROCESS_INFO, SERVICE_WIN32, SERVICE_ACTIVE,
-        nullptr, 0, &bytesNeeded, &serviceCount, &resumeHandle, nullptr);
-
-    std::vector<BYTE> buffer(bytesNeeded);
-    if (::EnumServicesStatusExW(hScm, SC_ENUM_PROCESS_INFO, SERVICE_WIN32, SERVICE_ACTIVE,
-        buffer.data(), static_cast<DWORD>(buffer.size()), &bytesNeeded, &serviceCount, &resumeHandle, nullptr))
-    {
-        auto* entries = reinterpret_cast<ENUM_SERVICE_STATUS_PROCESSW*>(buffer.data());
-        for (DWORD i = 0; i < serviceCount; ++i) {
-            names.emplace_back(entries[i].lpServiceName);
-        }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+const char* ResolutionName(ServiceHistory::Resolution resolution)
+{
+    switch (resolution) {
+    case ServiceHistory::Resolution::TenSeconds: return "10s";
+    case ServiceHistory::Resolution::OneMinute:  return "1m";
+    default:                                     return "raw";
+    }
+}
+
+// Windows accepted by GET_STATS and GET_TOP
+constexpr std::pair<const char*, ServiceHistory::StatsWindow> StatsWindows[] = {
+    { "1m", ServiceHistory::StatsWindow::OneMinute },
+    { "15m", ServiceHistory::StatsWindow::FifteenMinutes },
+    { "1h", ServiceHistory::StatsWindow::OneHour },
+};
+
+constexpr int64_t DefaultTopN = 10;
+
+#ifndef USE_BUNDLED_JSON
+// One GET_HISTORY series entry holding points [offset, offset + count)
+json RawSeriesJson(const std::string& name, const HistoryRing::Samples& samples, size_t offset, size_t count)
+{
+    json timestamps = json::array(), cpu = json::array(), memory = json::array();
+    for (size_t i = offset; i < offset + count; ++i) {
+        timestamps.push_back(samples.timestampsMs[i]);
+        cpu.push_back(samples.cpu[i]);
+        memory.push_back(samples.memory[i]);
+    }
+    json svc;
+    svc["name"] = name;
+    svc["timestamps"] = std::move(timestamps);
+    svc["cpu"] = std::move(cpu);
+    svc["memoryMB"] = std::move(memory);
+    return svc;
+}
+
+json AlertEventJson(const AlertEvent& event, const ServiceRegistry& registry)
+{
+    json e;
+    e["sequence"] = event.sequence;
+    e["timestampMs"] = event.timestampMs;
+    e["service"] = registry.Utf8Name(event.service);
+    e["ruleId"] = event.ruleId;
+    e["rule"] = event.rule;
+    e["state"] = event.firing ? "firing" : "resolved";
+    e["value"] = event.value;
+    return e;
+}
+
+json RollupSeriesJson(const std::string& name, std::span<const RollupPoint> points)
+{
+    // cpu/memoryMB carry the bucket averages; the other aggregates sit alongside
+    json timeArr = json::array(), cpuArr = json::array(), memArr = json::array();
+    json cpuMin = json::array(), cpuMax = json::array(), cpuLast = json::array();
+    json memMin = json::array(), memMax = json::array(), memLast = json::array();
+    for (const auto& point : points) {
+        timeArr.push_back(point.startMs);
+        cpuArr.push_back(point.cpuAvg);
+        memArr.push_back(point.memoryAvg);
+        cpuMin.push_back(point.cpuMin);
+        cpuMax.push_back(point.cpuMax);
+        cpuLast.push_back(point.cpuLast);
+        memMin.push_back(point.memoryMin);
+        memMax.push_back(point.memoryMax);
+        memLast.push_back(point.memoryLast);
     }
-    ::CloseServiceHandle(hScm);
-    return names;
+    json svc;
+    svc["name"] = name;
+    svc["timestamps"] = std::move(timeArr);
+    svc["cpu"] = std::move(cpuArr);
+    svc["memoryMB"] = std::move(memArr);
+    svc["cpuMin"] = std::move(cpuMin);
+    svc["cpuMax"] = std::move(cpuMax);
+    svc["cpuLast"] = std::move(cpuLast);
+    svc["memoryMBMin"] = std::move(memMin);
+    svc["memoryMBMax"] = std::move(memMax);
+    svc["memoryMBLast"] = std::move(memLast);
+    return svc;
 }
+#endif
 
 } // anonymous namespace
 
-MonitorService::MonitorService()
+MonitorService::MonitorService(std::filesystem::path historyPath)
     : ServiceBase(L"ServiceMonitorCore")
+    , historyPath_(std::move(historyPath))
+    , snapshot_(std::make_shared<const HistorySnapshot>())
+    , runId_(WallClockMs())
+    , tickLog_(TickLogCapacity)
 {
+    collector_.SetBaselineRetention(sampleIntervalCeiling_.load() + 1);
 }
 
 void MonitorService::OnStart(DWORD /*argc*/, LPWSTR* /*argv*/)
 {
     Logger::Info(L"MonitorService starting");
 
-    pipeServer_.SetMessageHandler([this](const std::string& req) {
-        return HandleRequest(req);
+    pipeServer_.SetMessageHandler([this](const std::string& req, IpcSession& session) {
+        return HandleRequest(req, session);
     });
+    OpenHistory();
     pipeServer_.Start();
+    tracker_.Start();
 
-    running_ = true;
+    ticker_.Reset();
     monitorThread_ = std::thread([this]() { MonitorLoop(); });
 
     Logger::Info(L"MonitorService started");
@@ -77,10 +154,12 @@ void MonitorService::OnStart(DWORD /*argc*/, LPWSTR* /*argv*/)
 void MonitorService::OnStop()
 {
     Logger::Info(L"MonitorService stopping");
-    running_ = false;
+    ticker_.Stop();
     if (monitorThread_.joinable())
         monitorThread_.join();
     pipeServer_.Stop();
+    tracker_.Stop();
+    historyFile_.Flush();
     Logger::Info(L"MonitorService stopped");
 }
 
@@ -88,12 +167,14 @@ void MonitorService::RunConsole()
 {
     Logger::Info(L"MonitorService starting (console mode)");
 
-    pipeServer_.SetMessageHandler([this](const std::string& req) {
-        return HandleRequest(req);
+    pipeServer_.SetMessageHandler([this](const std::string& req, IpcSession& session) {
+        return HandleRequest(req, session);
     });
+    OpenHistory();
     pipeServer_.Start();
+    tracker_.Start();
 
-    running_ = true;
+    ticker_.Reset();
     monitorThread_ = std::thread([this]() { MonitorLoop(); });
 
     Logger::Info(L"MonitorService started (console mode)");
@@ -102,56 +183,430 @@ void MonitorService::RunConsole()
 void MonitorService::StopConsole()
 {
     Logger::Info(L"MonitorService stopping (console mode)");
-    running_ = false;
+    ticker_.Stop();
     if (monitorThread_.joinable())
         monitorThread_.join();
     pipeServer_.Stop();
+    tracker_.Stop();
+    historyFile_.Flush();
     Logger::Info(L"MonitorService stopped (console mode)");
 }
 
 void MonitorService::MonitorLoop()
 {
-    while (running_) {
+    // Ticks fire on absolute deadlines; Stop() wakes the wait for prompt shutdown
+    while (ticker_.WaitNext()) {
         CollectAllMetrics();
-        // Sleep in small increments to allow quick shutdown
-        for (int i = 0; i < monitoringIntervalMs_.load() / 100 && running_; ++i) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
+        PushSubscriptions();
+        ticker_.EndTick();
     }
 }
 
 void MonitorService::CollectAllMetrics()
 {
-    auto names = GetRunningServiceNames();
+    bool servicesChanged = true;
+    if (tracker_.IsLive()) {
+        // The tracker is kept current by SCM notifications; re-copy only when it changed
+        auto version = tracker_.Version();
+        servicesChanged = version != servicesVersion_;
+        if (servicesChanged) {
+            tracker_.CopyActive(services_);
+            servicesVersion_ = version;
+        }
+    }
+    // Otherwise one EnumServicesStatusEx call yields name, PID and state for every active service
+    else if (!collector_.EnumerateServices(services_)) {
+        return;
+    }
 
+    bool adaptive = adaptiveSampling_.load();
+    auto ceiling = static_cast<uint32_t>(sampleIntervalCeiling_.load());
+    if (ceiling != scheduler_.MaxIntervalTicks()) {
+        scheduler_.SetMaxIntervalTicks(ceiling);
+        collector_.SetBaselineRetention(ceiling + 1);
+    }
+    scheduler_.SetAdaptive(adaptive);
+    scheduler_.BeginTick();
+    if (servicesChanged)
+        MapServiceIds();
+
+    // Only PIDs hosting at least one due service are sampled this tick.
     // Deduplicate PIDs — multiple services may share the same svchost.exe process.
     // Collect metrics once per PID, then distribute to all services sharing that PID.
-    std::unordered_map<DWORD, ServiceDataPoint> pidMetrics;
-    std::vector<std::pair<std::string, DWORD>> servicesPids;
+    pids_.clear();
+    for (size_t i = 0; i < services_.size(); ++i) {
+        if (services_[i].processId != 0 && scheduler_.IsDue(serviceIds_[i], services_[i].processId))
+            pids_.push_back(services_[i].processId);
+    }
+    std::sort(pids_.begin(), pids_.end());
+    pids_.erase(std::unique(pids_.begin(), pids_.end()), pids_.end());
+    pidMetrics_.resize(pids_.size());
 
-    for (const auto& wName : names) {
-        auto pid = ResourceCollector::GetServiceProcessId(wName);
-        if (pid == 0) continue;
-        servicesPids.emplace_back(WideToUtf8(wName), pid);
+    int threads = collectorThreads_.load();
+    if (threads > 1) {
+        // Parallel mode: per-PID queries sharded across the worker pool
+        if (!pool_ || pool_->ThreadCount() != static_cast<size_t>(threads - 1))
+            pool_ = std::make_unique<WorkerPool>(threads - 1);
+        collector_.CollectMany(pids_, pidMetrics_, pool_.get());
+    }
+    else {
+        pool_.reset();
+        // One bulk process query per tick instead of OpenProcess per PID,
+        // unless only a handful of services are due
+        if (pids_.size() >= SnapshotMinPids && collector_.TakeSnapshot()) {
+            for (size_t i = 0; i < pids_.size(); ++i)
+                pidMetrics_[i] = collector_.CollectFromSnapshot(pids_[i]);
+        }
+        else if (!pids_.empty()) {
+            collector_.CollectMany(pids_, pidMetrics_, nullptr);
+        }
+    }
+    collector_.EndTick();
+
+    // One stamp per tick, shared by every sample it produces
+    auto tick = ticker_.CurrentTick();
+    auto timestampMs = tick.wallMs;
+    RecordTick(tick);
+    alerts_.BeginTick(timestampMs);
+
+    // Every service on a sampled PID gets the fresh point, due or not
+    for (size_t i = 0; i < services_.size(); ++i) {
+        auto processId = services_[i].processId;
+        if (processId == 0) continue;
+        auto it = std::lower_bound(pids_.begin(), pids_.end(), processId);
+        if (it == pids_.end() || *it != processId) continue;
+        const auto& metrics = pidMetrics_[it - pids_.begin()];
+        scheduler_.Record(serviceIds_[i], metrics.cpuPercent, metrics.memoryMB);
+        HistoryFor(serviceIds_[i]).Push(timestampMs, metrics.cpuPercent, metrics.memoryMB);
+        alerts_.Evaluate(serviceIds_[i], timestampMs, metrics.cpuPercent, metrics.memoryMB);
+    }
 
-        if (pidMetrics.find(pid) == pidMetrics.end()) {
-            auto metrics = collector_.Collect(pid);
-            pidMetrics[pid] = { metrics.cpuPercent, metrics.memoryMB };
+    runningIds_.clear();
+    for (size_t i = 0; i < services_.size(); ++i) {
+        if (services_[i].processId != 0)
+            runningIds_.push_back(serviceIds_[i]);
+    }
+    std::sort(runningIds_.begin(), runningIds_.end());
+    alerts_.EndTick(runningIds_, timestampMs);
+
+    PublishSnapshot(tick);
+}
+
+void MonitorService::RecordTick(const TickScheduler::TickStamp& tick)
+{
+    // Per-entry seqlock: a zero sequence marks the entry as being rewritten
+    auto& entry = tickLog_[tick.sequence % TickLogCapacity];
+    entry.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.wallMs.store(tick.wallMs, std::memory_order_relaxed);
+    entry.sequence.store(tick.sequence, std::memory_order_release);
+}
+
+void MonitorService::PublishSnapshot(const TickScheduler::TickStamp& tick)
+{
+    auto snapshot = std::make_shared<HistorySnapshot>();
+    snapshot->tick = tick;
+    snapshot->services.reserve(history_.size());
+    for (ServiceId id = 0; id < history_.size(); ++id) {
+        const ServiceHistory* history = history_[id].get();
+        if (!history) continue;
+        HistorySnapshot::Service entry{ id, &registry_.Utf8Name(id), history };
+        if (!history->Raw().Empty()) {
+            entry.hasSample = true;
+            entry.cpu = history->Raw().LatestCpu();
+            entry.memoryMB = history->Raw().LatestMemory();
         }
+        snapshot->services.push_back(entry);
+    }
+    snapshot_.store(std::move(snapshot));
+}
+
+void MonitorService::PushSubscriptions()
+{
+#ifndef USE_BUNDLED_JSON
+    if (pipeServer_.SubscriberCount() == 0) {
+        // Alert subscribers are sent events from the time they subscribe
+        alertsPushed_ = alerts_.LastSequence();
+        return;
     }
 
-    std::lock_guard lock(historyMutex_);
-    for (const auto& [key, pid] : servicesPids) {
-        const auto& dp = pidMetrics[pid];
-        auto& dq = history_[key];
-        dq.push_back(dp);
-        while (dq.size() > MaxHistory) {
-            dq.pop_front();
+    // A tick that published nothing (enumeration failed) has nothing to push
+    auto snapshot = snapshot_.load();
+    if (snapshot->tick.sequence == pushedSequence_)
+        return;
+    pushedSequence_ = snapshot->tick.sequence;
+
+    std::vector<AlertEvent> events;
+    bool eventsComplete = alerts_.EventsSince(alertsPushed_, events);
+    if (!events.empty())
+        alertsPushed_ = events.back().sequence;
+
+    // Half a period of slack, so jitter between ticks does not skip a push that is due
+    int64_t slackMs = ticker_.Period().count() / 2;
+    std::unordered_map<std::string, PipeServer::SharedMessage> messages;   // by Subscription::key
+    pipeServer_.Push([&](IpcSession& session) -> PipeServer::SharedMessage {
+        auto& subscription = static_cast<Subscription&>(*session.subscription);
+        if (subscription.topic == Subscription::Topic::Alerts) {
+            if (events.empty())
+                return nullptr;
         }
+        else {
+            if (snapshot->tick.wallMs < subscription.nextMs)
+                return nullptr;
+            subscription.nextMs = snapshot->tick.wallMs + subscription.intervalMs - slackMs;
+        }
+
+        auto& message = messages[subscription.key];
+        if (!message)
+            message = std::make_shared<const std::string>(SerializePush(subscription, *snapshot, events, eventsComplete));
+        return message;
+    });
+#endif
+}
+
+#ifndef USE_BUNDLED_JSON
+std::string MonitorService::SerializePush(const Subscription& subscription, const HistorySnapshot& snapshot,
+                                          const std::vector<AlertEvent>& events, bool eventsComplete) const
+{
+    if (subscription.topic == Subscription::Topic::Alerts) {
+        json eventArr = json::array();
+        for (const auto& event : events)
+            eventArr.push_back(AlertEventJson(event, registry_));
+        json msg;
+        msg["topic"] = "alerts";
+        msg["events"] = eventArr;
+        msg["lastSequence"] = events.empty() ? 0 : events.back().sequence;
+        msg["behind"] = !eventsComplete;
+        return subscription.binary ? wire::JsonFrame(msg.dump()) : msg.dump();
+    }
+
+    bool all = subscription.topic == Subscription::Topic::AllStatus;
+    auto wanted = [&](const HistorySnapshot::Service& entry) {
+        return entry.hasSample &&
+               (all || std::binary_search(subscription.services.begin(), subscription.services.end(), entry.id));
+    };
+
+    if (subscription.binary) {
+        // The frame goes to several clients, so it carries its whole name table
+        std::vector<ServiceId> ids;
+        for (const auto& entry : snapshot.services)
+            if (wanted(entry)) ids.push_back(entry.id);
+        std::vector<bool> namesSent;
+
+        std::string frame;
+        wire::FrameWriter writer(frame, wire::FrameKind::AllStatus);
+        writer.Names(ids, registry_, namesSent);
+        writer.Varint(ids.size());
+        for (const auto& entry : snapshot.services) {
+            if (!wanted(entry)) continue;
+            writer.Varint(entry.id);
+            writer.Float(entry.cpu);
+            writer.Float(entry.memoryMB);
+        }
+        writer.Finish();
+        return frame;
+    }
+
+    json services = json::array();
+    for (const auto& entry : snapshot.services) {
+        if (!wanted(entry)) continue;
+        json svc;
+        svc["name"] = *entry.name;
+        svc["cpu"] = entry.cpu;
+        svc["memoryMB"] = entry.memoryMB;
+        services.push_back(svc);
     }
+    json msg;
+    msg["topic"] = all ? "all-status" : "services";
+    msg["tick"] = snapshot.tick.sequence;
+    msg["timestampMs"] = snapshot.tick.wallMs;
+    msg["services"] = services;
+    return msg.dump();
+}
+#endif
+
+void MonitorService::MapServiceIds()
+{
+    // The table order is stable between refreshes, so a name compare usually confirms the old ID
+    serviceIds_.resize(services_.size(), std::numeric_limits<ServiceId>::max());
+    for (size_t i = 0; i < services_.size(); ++i) {
+        auto id = serviceIds_[i];
+        if (id >= registry_.Size() || registry_.WideName(id) != services_[i].name)
+            serviceIds_[i] = registry_.Intern(services_[i].name);
+    }
+}
+
+std::string MonitorService::MakeCursor(uint64_t sequence) const
+{
+    return std::to_string(runId_) + "-" + std::to_string(sequence);
 }
 
-std::string MonitorService::HandleRequest(const std::string& requestJson)
+bool MonitorService::ResolveCursor(const std::string& cursor, uint64_t latestSequence, int64_t& wallMs) const
+{
+    auto dash = cursor.find('-');
+    if (dash == std::string::npos)
+        return false;
+
+    int64_t runId = 0;
+    uint64_t sequence = 0;
+    const char* end = cursor.data() + cursor.size();
+    if (std::from_chars(cursor.data(), cursor.data() + dash, runId).ptr != cursor.data() + dash ||
+        std::from_chars(cursor.data() + dash + 1, end, sequence).ptr != end)
+        return false;
+
+    if (runId != runId_ || sequence > latestSequence)
+        return false;
+
+    const auto& entry = tickLog_[sequence % TickLogCapacity];
+    uint64_t before = entry.sequence.load(std::memory_order_acquire);
+    int64_t stamp = entry.wallMs.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (before != sequence || entry.sequence.load(std::memory_order_relaxed) != sequence)
+        return false;
+    wallMs = stamp;
+    return true;
+}
+
+#ifndef USE_BUNDLED_JSON
+void MonitorService::NextHistoryPart(HistoryStream& stream, IpcSession& session, std::string& message) const
+{
+    const auto& services = stream.snapshot->services;
+    bool raw = stream.resolution == ServiceHistory::Resolution::Raw;
+
+    // Series go into `body` first: a JSON array's elements, or a frame body fragment whose
+    // name table is only known once the part is filled
+    std::string body;
+    wire::FrameWriter series(body);
+    std::vector<ServiceId> ids;
+    size_t budget = HistoryPartPoints;
+    while (stream.service < services.size() && budget > 0) {
+        const auto& entry = services[stream.service];
+        if (!stream.copied) {
+            if (raw)
+                entry.history->CopyRaw(stream.fromMs, stream.toMs, stream.samples);
+            else
+                entry.history->CopyRollup(stream.resolution, stream.fromMs, stream.toMs, stream.points);
+            stream.copied = true;
+            stream.offset = 0;
+        }
+        size_t total = raw ? stream.samples.Size() : stream.points.size();
+        size_t count = std::min(total - stream.offset, budget);
+        auto points = raw ? std::span<const RollupPoint>()
+                          : std::span<const RollupPoint>(stream.points).subspan(stream.offset, count);
+
+        // Frames list every service; JSON leaves out those with nothing new since the cursor
+        if (session.binaryFrames) {
+            ids.push_back(entry.id);
+            if (raw)
+                series.RawSeries(entry.id, stream.samples, stream.offset, count);
+            else
+                series.RollupSeries(entry.id, points);
+        }
+        else if (!stream.incremental || total > 0) {
+            if (!body.empty())
+                body += ',';
+            body += (raw ? RawSeriesJson(*entry.name, stream.samples, stream.offset, count)
+                         : RollupSeriesJson(*entry.name, points)).dump();
+        }
+
+        // An empty series counts too, so a part also holds a bounded number of services
+        budget -= std::max<size_t>(count, 1);
+        stream.offset += count;
+        if (stream.offset == total) {
+            ++stream.service;
+            stream.copied = false;
+        }
+    }
+    stream.done = stream.service == services.size();
+
+    if (session.binaryFrames) {
+        wire::FrameWriter writer(message, stream.done ? wire::FrameKind::History : wire::FrameKind::HistoryPart);
+        writer.Byte(static_cast<uint8_t>(stream.resolution));
+        writer.String(stream.cursor);
+        writer.Byte(stream.behind);
+        writer.Names(ids, registry_, session.namesSent);
+        writer.Varint(ids.size());
+        writer.Append(body);
+        writer.Finish();
+        return;
+    }
+
+    json head;
+    head["status"] = "OK";
+    head["resolution"] = ResolutionName(stream.resolution);
+    head["cursor"] = stream.cursor;
+    head["behind"] = stream.behind;
+    if (!stream.done)
+        head["more"] = true;
+
+    // Splice the serialized series in as the last member
+    message = head.dump();
+    message.pop_back();
+    message += R"(,"services":[)";
+    message += body;
+    message += "]}";
+}
+#endif
+
+void MonitorService::WatchService(const std::wstring& serviceName)
+{
+    ServiceId id = 0;
+    if (registry_.Find(serviceName, id))
+        scheduler_.Watch(id);
+}
+
+void MonitorService::OpenHistory()
+{
+    if (historyPath_.empty() || historyFile_.IsOpen())
+        return;
+
+    if (!historyFile_.Open(historyPath_, MaxPersistedServices)) {
+        Logger::Error(L"Cannot map history file, keeping history in memory: " + historyPath_.wstring());
+        return;
+    }
+
+    // Regions are claimed when their service is first seen (HistoryFor), so slots of
+    // services that no longer exist stay evictable
+    TickScheduler::TickStamp restoredTick;
+    restoredTick.wallMs = std::max(restoredTick.wallMs, historyFile_.LatestTimestampMs());
+    Logger::Info(L"Mapped history file: " + historyPath_.wstring());
+
+    // Tick 0 stands for the restored data until the first tick is published
+    RecordTick(restoredTick);
+    PublishSnapshot(restoredTick);
+}
+
+ServiceHistory& MonitorService::HistoryFor(ServiceId id)
+{
+    if (id >= history_.size())
+        history_.resize(id + 1);
+
+    auto& history = history_[id];
+    if (!history) {
+        ServiceHistory::Region region;
+        if (historyFile_.IsOpen() && historyFile_.Acquire(registry_.Utf8Name(id), region))
+            history = std::make_unique<ServiceHistory>(region);
+        else
+            history = std::make_unique<ServiceHistory>();
+    }
+    return *history;
+}
+
+ServiceEntry MonitorService::LookupService(const std::wstring& serviceName)
+{
+    ServiceEntry entry{};
+    entry.name = serviceName;
+
+    bool found = tracker_.IsLive() ? tracker_.Lookup(serviceName, entry)
+                                   : collector_.QueryService(serviceName, entry);
+    if (!found) {
+        entry.processId = 0;
+        entry.state = ServiceState::Unknown;
+    }
+    return entry;
+}
+
+std::string MonitorService::HandleRequest(const std::string& requestJson, IpcSession& session)
 {
 #ifndef USE_BUNDLED_JSON
     try {
@@ -163,60 +618,367 @@ std::string MonitorService::HandleRequest(const std::string& requestJson)
 
         if (command == "GET_STATUS") {
             auto wTarget = Utf8ToWide(target);
+            WatchService(wTarget);
 
-            auto status = ResourceCollector::GetServiceStatus(wTarget);
-            auto pid = ResourceCollector::GetServiceProcessId(wTarget);
-            auto metrics = collector_.Collect(pid);
+            auto service = LookupService(wTarget);
+            auto metrics = collector_.Collect(service.processId);
 
-            resp["status"] = WideToUtf8(status);
+            resp["status"] = WideToUtf8(ServiceStateName(service.state));
             resp["cpu"] = metrics.cpuPercent;
             resp["memoryMB"] = metrics.memoryMB;
             resp["uptimeSeconds"] = static_cast<int64_t>(metrics.uptimeSeconds);
-            resp["executablePath"] = WideToUtf8(ResourceCollector::GetServiceExecutablePath(wTarget));
+            resp["executablePath"] = WideToUtf8(collector_.GetServiceExecutablePath(wTarget));
         }
         else if (command == "GET_ALL_STATUS") {
-            std::lock_guard lock(historyMutex_);
+            // Latest values come from the published snapshot; the collector is never waited on
+            auto snapshot = snapshot_.load();
+            if (session.binaryFrames) {
+                std::vector<ServiceId> ids;
+                for (const auto& entry : snapshot->services)
+                    if (entry.hasSample) ids.push_back(entry.id);
+
+                std::string frame;
+                wire::FrameWriter writer(frame, wire::FrameKind::AllStatus);
+                writer.Names(ids, registry_, session.namesSent);
+                writer.Varint(ids.size());
+                for (const auto& entry : snapshot->services) {
+                    if (!entry.hasSample) continue;
+                    writer.Varint(entry.id);
+                    writer.Float(entry.cpu);
+                    writer.Float(entry.memoryMB);
+                }
+                writer.Finish();
+                return frame;
+            }
+
             json services = json::array();
-            for (const auto& [name, dq] : history_) {
-                if (dq.empty()) continue;
+            for (const auto& entry : snapshot->services) {
+                if (!entry.hasSample) continue;
                 json svc;
-                svc["name"] = name;
-                svc["cpu"] = dq.back().cpuPercent;
-                svc["memoryMB"] = dq.back().memoryMB;
+                svc["name"] = *entry.name;
+                svc["cpu"] = entry.cpu;
+                svc["memoryMB"] = entry.memoryMB;
                 services.push_back(svc);
             }
             resp["status"] = "OK";
             resp["services"] = services;
         }
         else if (command == "GET_HISTORY") {
-            std::lock_guard lock(historyMutex_);
+            // Unix ms bounds [from, to]; rangeSeconds is shorthand for from = now - range.
+            // How far back `from` reaches picks the tier: raw up to 2 h, 10 s rollups up to 24 h, then 1 min
+            int64_t nowMs = WallClockMs();
+            int64_t rangeMs = req.value("rangeSeconds", int64_t{ 0 }) * 1000;
+            int64_t fromMs = req.value("from", rangeMs > 0 ? nowMs - rangeMs : std::numeric_limits<int64_t>::min());
+            int64_t toMs = req.value("to", std::numeric_limits<int64_t>::max());
+            auto resolution = ServiceHistory::SelectResolution(
+                fromMs == std::numeric_limits<int64_t>::min() ? 0 : nowMs - fromMs);
+
+            // Serve the tick the snapshot was published at, so the cursor matches the data even
+            // while the collector pushes the next tick into the rings being copied
+            auto snapshot = snapshot_.load();
+            uint64_t latestSequence = snapshot->tick.sequence;
+            toMs = std::min(toMs, snapshot->tick.wallMs);
+
+            // sinceCursor (from a previous response) keeps only samples newer than that tick;
+            // rollup buckets still open at that tick are sent again with their updated values.
+            // A cursor past retention or from an earlier run sets `behind` and the range is sent whole.
+            auto sinceCursor = req.value("sinceCursor", std::string());
+            bool incremental = false;
+            bool behind = false;
+            if (!sinceCursor.empty()) {
+                int64_t cursorMs = 0;
+                incremental = ResolveCursor(sinceCursor, latestSequence, cursorMs);
+                behind = !incremental;
+                if (incremental)
+                    fromMs = std::max(fromMs, cursorMs + 1);
+            }
+
+            // Sent in parts of bounded size, each serialized only once the previous one is out
+            auto stream = std::make_shared<HistoryStream>();
+            stream->snapshot = std::move(snapshot);
+            stream->resolution = resolution;
+            stream->fromMs = fromMs;
+            stream->toMs = toMs;
+            stream->incremental = incremental;
+            stream->behind = behind;
+            stream->cursor = MakeCursor(latestSequence);
+
+            std::string message;
+            NextHistoryPart(*stream, session, message);
+            if (!stream->done) {
+                session.nextMessage = [this, stream](IpcSession& client, std::string& next) {
+                    if (stream->done)
+                        return false;
+                    NextHistoryPart(*stream, client, next);
+                    return true;
+                };
+            }
+            return message;
+        }
+        else if (command == "GET_STATS") {
+            // p50/p95/p99/max per service from the sliding-window sketches; `window` picks one
+            // of 1m/15m/1h, otherwise all three are returned
+            auto only = req.value("window", std::string());
+
+            auto snapshot = snapshot_.load();
+            auto toJson = [](const ServiceHistory::Quantiles& q) {
+                json out;
+                out["count"] = q.count;
+                out["p50"] = q.p50;
+                out["p95"] = q.p95;
+                out["p99"] = q.p99;
+                out["max"] = q.max;
+                return out;
+            };
+
             json services = json::array();
-            for (const auto& [name, dq] : history_) {
+            for (const auto& entry : snapshot->services) {
+                if (!entry.hasSample) continue;
                 json svc;
-                svc["name"] = name;
-                json cpuArr = json::array();
-                json memArr = json::array();
-                for (const auto& dp : dq) {
-                    cpuArr.push_back(dp.cpuPercent);
-                    memArr.push_back(dp.memoryMB);
+                svc["name"] = *entry.name;
+                for (const auto& [name, window] : StatsWindows) {
+                    if (!only.empty() && only != name) continue;
+                    ServiceHistory::Quantiles cpu, memory;
+                    entry.history->GetStats(window, snapshot->tick.wallMs, cpu, memory);
+                    svc[name]["cpu"] = toJson(cpu);
+                    svc[name]["memoryMB"] = toJson(memory);
                 }
-                svc["cpu"] = cpuArr;
-                svc["memoryMB"] = memArr;
                 services.push_back(svc);
             }
             resp["status"] = "OK";
             resp["services"] = services;
         }
+        else if (command == "GET_TOP") {
+            // The n highest scores, score = cpuWeight * cpu + memoryWeight * memoryMB (1 and 1 by
+            // default); metric "cpu" or "memory" ranks by that column alone. Scores use the latest
+            // sample, or the 1m/15m/1h average from the sketches when `window` is given.
+            // Only the top n are selected (nth_element) and sorted.
+            auto metric = req.value("metric", std::string("weighted"));
+            double cpuWeight = req.value("cpuWeight", 1.0);
+            double memoryWeight = req.value("memoryWeight", 1.0);
+            if (metric == "cpu")
+                memoryWeight = 0.0;
+            else if (metric == "memory")
+                cpuWeight = 0.0;
+
+            auto windowName = req.value("window", std::string("latest"));
+            const ServiceHistory::StatsWindow* window = nullptr;
+            for (const auto& [name, w] : StatsWindows) {
+                if (windowName == name) window = &w;
+            }
+
+            int64_t n = req.value("n", DefaultTopN);
+            if (n <= 0) n = DefaultTopN;
+
+            if (metric != "weighted" && metric != "cpu" && metric != "memory") {
+                resp["error"] = "Unknown metric: " + metric;
+            }
+            else if (!window && windowName != "latest") {
+                resp["error"] = "Unknown window: " + windowName;
+            }
+            else {
+                struct Ranked {
+                    double score;
+                    double cpu;
+                    double memoryMB;
+                    const std::string* name;
+                };
+
+                auto snapshot = snapshot_.load();
+                std::vector<Ranked> ranked;
+                ranked.reserve(snapshot->services.size());
+                for (const auto& entry : snapshot->services) {
+                    if (!entry.hasSample) continue;
+                    double cpu = entry.cpu, memoryMB = entry.memoryMB;
+                    if (window)
+                        entry.history->GetMeans(*window, snapshot->tick.wallMs, cpu, memoryMB);
+                    ranked.push_back({ cpuWeight * cpu + memoryWeight * memoryMB, cpu, memoryMB, entry.name });
+                }
+
+                auto higher = [](const Ranked& a, const Ranked& b) { return a.score > b.score; };
+                auto top = ranked.begin() + static_cast<ptrdiff_t>(std::min<size_t>(static_cast<size_t>(n), ranked.size()));
+                std::nth_element(ranked.begin(), top, ranked.end(), higher);
+                std::sort(ranked.begin(), top, higher);
+
+                json services = json::array();
+                for (auto it = ranked.begin(); it != top; ++it) {
+                    json svc;
+                    svc["name"] = *it->name;
+                    svc["score"] = it->score;
+                    svc["cpu"] = it->cpu;
+                    svc["memoryMB"] = it->memoryMB;
+                    services.push_back(svc);
+                }
+                resp["status"] = "OK";
+                resp["window"] = windowName;
+                resp["services"] = services;
+            }
+        }
+        else if (command == "SET_ALERT_RULES") {
+            // Rules are compiled here and take effect at the next tick; one bad rule rejects the set
+            std::vector<AlertRule> rules;
+            std::string error;
+            for (const auto& text : req.value("rules", json::array())) {
+                AlertRule rule;
+                if (!text.is_string() || !AlertRule::Compile(text.get<std::string>(), rule, error)) {
+                    error = "Invalid rule " + text.dump() + (error.empty() ? "" : ": " + error);
+                    break;
+                }
+                rules.push_back(std::move(rule));
+            }
+            if (error.empty()) {
+                resp["ruleIds"] = alerts_.SetRules(std::move(rules));
+                resp["status"] = "OK";
+            }
+            else {
+                resp["error"] = error;
+            }
+        }
+        else if (command == "GET_ALERTS") {
+            // Events after sinceSequence; `behind` means some were already dropped from the ring
+            std::vector<AlertEvent> events;
+            bool complete = alerts_.EventsSince(req.value("sinceSequence", uint64_t{ 0 }), events);
+
+            json eventArr = json::array();
+            uint64_t lastSequence = 0;
+            for (const auto& event : events) {
+                eventArr.push_back(AlertEventJson(event, registry_));
+                lastSequence = event.sequence;
+            }
+            json activeArr = json::array();
+            for (const auto& alert : alerts_.Active()) {
+                json a;
+                a["service"] = registry_.Utf8Name(alert.service);
+                a["ruleId"] = alert.ruleId;
+                a["rule"] = alert.rule;
+                a["sinceMs"] = alert.sinceMs;
+                activeArr.push_back(a);
+            }
+
+            json ruleTexts = json::array(), ruleIds = json::array();
+            for (const auto& rule : alerts_.Rules()) {
+                ruleTexts.push_back(rule.text);
+                ruleIds.push_back(rule.id);
+            }
+
+            resp["status"] = "OK";
+            resp["rules"] = ruleTexts;
+            resp["ruleIds"] = ruleIds;
+            resp["events"] = eventArr;
+            resp["active"] = activeArr;
+            resp["lastSequence"] = std::max(lastSequence, req.value("sinceSequence", uint64_t{ 0 }));
+            resp["behind"] = !complete;
+        }
         else if (command == "SET_INTERVAL") {
             int interval = req.value("intervalMs", 1000);
             if (interval >= 500) {
-                monitoringIntervalMs_ = interval;
+                ticker_.SetPeriod(std::chrono::milliseconds(interval));
                 resp["status"] = "OK";
             }
             else {
                 resp["error"] = "Interval must be >= 500ms";
             }
         }
+        else if (command == "SET_COLLECTOR_THREADS") {
+            int threads = req.value("threads", 0);
+            if (threads >= 0 && threads <= MaxCollectorThreads) {
+                collectorThreads_ = threads;
+                resp["status"] = "OK";
+            }
+            else {
+                resp["error"] = "Threads must be between 0 and " + std::to_string(MaxCollectorThreads);
+            }
+        }
+        else if (command == "GET_TICK_STATS") {
+            auto stats = ticker_.GetStats();
+            resp["status"] = "OK";
+            resp["intervalMs"] = static_cast<int64_t>(ticker_.Period().count());
+            resp["ticks"] = stats.ticks;
+            resp["skippedTicks"] = stats.skippedTicks;
+            resp["overruns"] = stats.overruns;
+            resp["lastJitterUs"] = stats.lastJitterUs;
+            resp["maxJitterUs"] = stats.maxJitterUs;
+            resp["meanJitterUs"] = stats.meanJitterUs;
+            resp["lastDurationUs"] = stats.lastDurationUs;
+        }
+        else if (command == "SET_SAMPLING") {
+            int ceiling = req.value("maxIntervalTicks", sampleIntervalCeiling_.load());
+            if (ceiling >= 1 && ceiling <= MaxSampleIntervalTicks) {
+                adaptiveSampling_ = req.value("adaptive", adaptiveSampling_.load());
+                sampleIntervalCeiling_ = ceiling;
+                resp["status"] = "OK";
+            }
+            else {
+                resp["error"] = "maxIntervalTicks must be between 1 and " + std::to_string(MaxSampleIntervalTicks);
+            }
+        }
+        else if (command == "WATCH") {
+            WatchService(Utf8ToWide(target));
+            resp["status"] = "OK";
+        }
+        else if (command == "SUBSCRIBE") {
+            // Makes this connection a push stream: after this reply the engine pushes each tick
+            // due and reads no more requests; closing the connection unsubscribes.
+            // topic: "all-status", "services" (the names in `services`) or "alerts";
+            // intervalMs spaces status pushes (0 = every tick), alerts go out as they happen
+            auto topic = req.value("topic", std::string("all-status"));
+            auto subscription = std::make_unique<Subscription>();
+            subscription->binary = session.binaryFrames;
+            subscription->intervalMs = std::max<int64_t>(req.value("intervalMs", int64_t{ 0 }), 0);
+
+            json unknown = json::array();
+            if (topic == "services") {
+                // Only services the engine has seen; the rest are reported back
+                subscription->topic = Subscription::Topic::Services;
+                for (const auto& name : req.value("services", json::array())) {
+                    ServiceId id = 0;
+                    if (name.is_string() && registry_.Find(Utf8ToWide(name.get<std::string>()), id))
+                        subscription->services.push_back(id);
+                    else
+                        unknown.push_back(name);
+                }
+                std::sort(subscription->services.begin(), subscription->services.end());
+                subscription->services.erase(std::unique(subscription->services.begin(), subscription->services.end()),
+                                             subscription->services.end());
+            }
+            else if (topic == "alerts") {
+                subscription->topic = Subscription::Topic::Alerts;
+            }
+
+            if (topic != "all-status" && topic != "services" && topic != "alerts") {
+                resp["error"] = "Unknown topic: " + topic;
+            }
+            else if (subscription->topic == Subscription::Topic::Services && subscription->services.empty()) {
+                resp["error"] = "No known service in `services`";
+                resp["unknown"] = unknown;
+            }
+            else {
+                subscription->key = (subscription->binary ? "binary/" : "json/") + topic;
+                for (ServiceId id : subscription->services)
+                    subscription->key += "/" + std::to_string(id);
+                session.subscription = std::move(subscription);
+                resp["status"] = "OK";
+                resp["topic"] = topic;
+                if (!unknown.empty())
+                    resp["unknown"] = unknown;
+            }
+        }
+        else if (command == "HELLO") {
+            // Encoding negotiation: `encodings` lists what the client reads, preferred first.
+            // This reply is still JSON text; the chosen encoding applies from the next response
+            std::string encoding = "json";
+            for (const auto& offered : req.value("encodings", json::array())) {
+                if (offered == "binary" || offered == "json") {
+                    encoding = offered.get<std::string>();
+                    break;
+                }
+            }
+            session.binaryFrames = encoding == "binary";
+            resp["status"] = "OK";
+            resp["protocolVersion"] = wire::ProtocolVersion;
+            resp["encoding"] = encoding;
+            return resp.dump();
+        }
         else if (command == "PING") {
             resp["status"] = "PONG";
         }
@@ -224,12 +986,13 @@ std::string MonitorService::HandleRequest(const std::string& requestJson)
             resp["error"] = "Unknown command: " + command;
         }
 
-        return resp.dump();
+        // Commands without a binary schema still answer in JSON, framed once negotiated
+        return session.binaryFrames ? wire::JsonFrame(resp.dump()) : resp.dump();
     }
     catch (const std::exception& ex) {
         json err;
         err["error"] = ex.what();
-        return err.dump();
+        return session.binaryFrames ? wire::JsonFrame(err.dump()) : err.dump();
     }
 #else
     try {
@@ -241,12 +1004,12 @@ std::string MonitorService::HandleRequest(const std::string& requestJson)
 
         if (command == "GET_STATUS") {
             auto wTarget = Utf8ToWide(target);
+            WatchService(wTarget);
 
-            auto status = ResourceCollector::GetServiceStatus(wTarget);
-            auto pid = ResourceCollector::GetServiceProcessId(wTarget);
-            auto metrics = collector_.Collect(pid);
+            auto service = LookupService(wTarget);
+            auto metrics = collector_.Collect(service.processId);
 
-            resp.set("status", WideToUtf8(status));
+            resp.set("status", WideToUtf8(ServiceStateName(service.state)));
             resp.set("cpu", metrics.cpuPercent);
             resp.set("memoryMB", metrics.memoryMB);
             resp.set("uptimeSeconds", static_cast<int64_t>(metrics.uptimeSeconds));
@@ -258,9 +1021,46 @@ std::string MonitorService::HandleRequest(const std::string& requestJson)
         else if (command == "GET_HISTORY") {
             resp.set("status", std::string("OK"));
         }
+        else if (command == "GET_STATS") {
+            resp.set("error", std::string("GET_STATS needs the nlohmann-json build"));
+        }
+        else if (command == "GET_TOP") {
+            resp.set("error", std::string("GET_TOP needs the nlohmann-json build"));
+        }
+        else if (command == "SET_ALERT_RULES" || command == "GET_ALERTS") {
+            resp.set("error", command + " needs the nlohmann-json build");
+        }
         else if (command == "SET_INTERVAL") {
             resp.set("status", std::string("OK"));
         }
+        else if (command == "SET_COLLECTOR_THREADS") {
+            resp.set("error", std::string("SET_COLLECTOR_THREADS needs the nlohmann-json build"));
+        }
+        else if (command == "GET_TICK_STATS") {
+            auto stats = ticker_.GetStats();
+            resp.set("status", std::string("OK"));
+            resp.set("ticks", static_cast<int64_t>(stats.ticks));
+            resp.set("skippedTicks", static_cast<int64_t>(stats.skippedTicks));
+            resp.set("overruns", static_cast<int64_t>(stats.overruns));
+            resp.set("maxJitterUs", stats.maxJitterUs);
+        }
+        else if (command == "SET_SAMPLING") {
+            resp.set("error", std::string("SET_SAMPLING needs the nlohmann-json build"));
+        }
+        else if (command == "WATCH") {
+            WatchService(Utf8ToWide(target));
+            resp.set("status", std::string("OK"));
+        }
+        else if (command == "SUBSCRIBE") {
+            resp.set("error", std::string("SUBSCRIBE needs the nlohmann-json build"));
+        }
+        else if (command == "HELLO") {
+            // The bundled build serves no series, so there is nothing worth framing
+            session.binaryFrames = false;
+            resp.set("status", std::string("OK"));
+            resp.set("protocolVersion", static_cast<int64_t>(wire::ProtocolVersion));
+            resp.set("encoding", std::string("json"));
+        }
         else if (command == "PING") {
             resp.set("status", std::string("PONG"));
         }
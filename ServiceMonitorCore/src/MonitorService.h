@@ -2,29 +2,32 @@
 
 #include "ServiceBase.h"
 #include "PipeServer.h"
+#include "AlertEngine.h"
+#include "HistoryFile.h"
+#include "ServiceHistory.h"
+#include "ServiceRegistry.h"
 #include "ResourceCollector.h"
+#include "SamplingScheduler.h"
+#include "ServiceStateTracker.h"
+#include "TickScheduler.h"
+#include "WorkerPool.h"
 
 #include <thread>
 #include <atomic>
 #include <mutex>
 #include <string>
 #include <chrono>
+#include <filesystem>
 #include <vector>
-#include <deque>
-#include <unordered_map>
+#include <memory>
 
 namespace smc {
 
-/// A snapshot of one service at one point in time.
-struct ServiceDataPoint {
-    double cpuPercent = 0.0;
-    double memoryMB = 0.0;
-};
-
 /// The main monitoring service. Inherits from ServiceBase for Windows Service lifecycle.
 class MonitorService : public ServiceBase {
 public:
-    MonitorService();
+    /// `historyPath` names the persisted history file; empty keeps history in memory only.
+    explicit MonitorService(std::filesystem::path historyPath = {});
     ~MonitorService() override = default;
 
     /// Run in console mode (no Windows Service registration).
@@ -38,8 +41,9 @@ protected:
     void OnStop() override;
 
 private:
-    /// Handles incoming IPC JSON requests.
-    std::string HandleRequest(const std::string& requestJson);
+    /// Handles incoming IPC JSON requests. Responses are JSON text unless the client
+    /// negotiated binary frames with HELLO.
+    std::string HandleRequest(const std::string& requestJson, IpcSession& session);
 
     /// Background monitoring loop that populates the history ring buffer.
     void MonitorLoop();
@@ -47,16 +51,145 @@ private:
     /// Enumerate all running Win32 services and collect metrics.
     void CollectAllMetrics();
 
+    /// Map the persisted history file and restore every service it holds.
+    void OpenHistory();
+
+    /// A service's history, created on first use (in the history file when it has room).
+    /// Monitor thread only.
+    ServiceHistory& HistoryFor(ServiceId id);
+
+    /// Log a tick's stamp for cursor lookups. Monitor thread only.
+    void RecordTick(const TickScheduler::TickStamp& tick);
+
+    /// Build a snapshot of history_ as of `tick` and publish it to readers. Monitor thread only.
+    void PublishSnapshot(const TickScheduler::TickStamp& tick);
+
+    /// Push the tick just published to every subscriber due for it, serializing each distinct
+    /// message once. Monitor thread only.
+    void PushSubscriptions();
+
+    /// Opaque GET_HISTORY cursor for a tick of this run.
+    std::string MakeCursor(uint64_t sequence) const;
+
+    /// Wall stamp of the tick a cursor names. Returns false if the cursor is malformed, from
+    /// another run, newer than `latestSequence`, or older than the tick log. Thread-safe.
+    bool ResolveCursor(const std::string& cursor, uint64_t latestSequence, int64_t& wallMs) const;
+
+    /// Refresh serviceIds_ for services_, interning only names not seen at that position before.
+    void MapServiceIds();
+
+    /// Ask the scheduler to keep a known service on the fast interval.
+    void WatchService(const std::wstring& serviceName);
+
+    /// Current PID and state of one service, from the tracker when it is live.
+    ServiceEntry LookupService(const std::wstring& serviceName);
+
     PipeServer pipeServer_;
     ResourceCollector collector_;
-    std::atomic<int> monitoringIntervalMs_{ 1000 };
-    std::atomic<bool> running_{ false };
+    ServiceStateTracker tracker_;
+    ServiceRegistry registry_;
+    std::vector<ServiceEntry> services_;    // reused service table, monitor thread only
+    std::vector<ServiceId> serviceIds_;     // registry ID of services_[i]
+    std::vector<ServiceId> runningIds_;     // sorted IDs of services_ with a process, rebuilt per tick
+    uint64_t servicesVersion_ = 0;          // tracker version services_ was copied at
+    TickScheduler ticker_{ std::chrono::milliseconds(1000) };
+
+    // Parallel collection: 0/1 = bulk snapshot on the monitor thread, N = per-PID queries on N threads
+    static constexpr int MaxCollectorThreads = 16;
+    std::atomic<int> collectorThreads_{ 0 };
+    std::unique_ptr<WorkerPool> pool_;      // monitor thread only
+    std::vector<ProcessId> pids_;
+    std::vector<ServiceMetrics> pidMetrics_;
+
+    // Adaptive sampling: idle services are sampled less often; settings are applied at the next tick
+    static constexpr int MaxSampleIntervalTicks = 256;
+    static constexpr size_t SnapshotMinPids = 8;   // fewer due PIDs than this: per-PID queries beat a full snapshot
+    SamplingScheduler scheduler_;           // monitor thread only (Watch() excepted)
+    std::atomic<bool> adaptiveSampling_{ true };
+    std::atomic<int> sampleIntervalCeiling_{ 32 };
+
+    // Alert rules run on every sample pushed; events are read by IPC threads
+    AlertEngine alerts_;
+
     std::thread monitorThread_;
 
-    // History ring buffer: service name -> deque of data points (max 7200 = 2hr @ 1s)
-    static constexpr size_t MaxHistory = 7200;
-    std::mutex historyMutex_;
-    std::unordered_map<std::string, std::deque<ServiceDataPoint>> history_;
+    // History per service: raw 2 h ring plus 10 s / 1 min rollup tiers (see ServiceHistory).
+    // Timestamps are wall clock, milliseconds since the Unix epoch. Raw rings live in
+    // historyFile_ when it is open, so it is declared first and outlives history_.
+    // Only the monitor thread writes history; IPC threads read through snapshot_ and
+    // never block it. Histories are never destroyed while the service runs.
+    static constexpr uint32_t MaxPersistedServices = 512;
+    std::filesystem::path historyPath_;
+    HistoryFile historyFile_;
+    std::vector<std::unique_ptr<ServiceHistory>> history_;     // indexed by ServiceId; monitor thread only
+
+    /// What readers see of history_, rebuilt after each tick and swapped in atomically.
+    /// Immutable once published.
+    struct HistorySnapshot {
+        struct Service {
+            ServiceId id = 0;
+            const std::string* name = nullptr;          // owned by registry_
+            const ServiceHistory* history = nullptr;
+            bool hasSample = false;
+            double cpu = 0.0;                           // latest sample, if any
+            double memoryMB = 0.0;
+        };
+        TickScheduler::TickStamp tick;
+        std::vector<Service> services;
+    };
+    std::atomic<std::shared_ptr<const HistorySnapshot>> snapshot_;
+
+    /// A GET_HISTORY response sent in parts of at most HistoryPartPoints points, so a dump
+    /// holds one part and one service's copied series however large the whole response is.
+    /// A series cut at a part boundary continues in the next part under the same name.
+    struct HistoryStream {
+        std::shared_ptr<const HistorySnapshot> snapshot;
+        ServiceHistory::Resolution resolution = ServiceHistory::Resolution::Raw;
+        int64_t fromMs = 0;
+        int64_t toMs = 0;
+        bool incremental = false;
+        bool behind = false;
+        std::string cursor;
+        size_t service = 0;                 // next entry of snapshot->services
+        size_t offset = 0;                  // its points already sent
+        bool copied = false;                // samples or points hold its series
+        bool done = false;                  // the last part has been serialized
+        HistoryRing::Samples samples;
+        std::vector<RollupPoint> points;
+    };
+    static constexpr size_t HistoryPartPoints = 1024;
+
+    /// Serialize the next part of `stream` into `message`, as JSON or a frame.
+    void NextHistoryPart(HistoryStream& stream, IpcSession& session, std::string& message) const;
+
+    /// A client's SUBSCRIBE: what it is pushed and how often.
+    struct Subscription : IpcSubscription {
+        enum class Topic { AllStatus, Services, Alerts };
+        Topic topic = Topic::AllStatus;
+        std::vector<ServiceId> services;    // Topic::Services, sorted
+        bool binary = false;                // frames rather than JSON text
+        int64_t intervalMs = 0;             // status topics; 0 = every tick
+        int64_t nextMs = 0;                 // earliest tick wall time of the next status push
+        std::string key;                    // subscriptions with equal keys share each message
+    };
+
+    /// One push for `subscription`: the latest values in `snapshot`, or `events` for alerts.
+    std::string SerializePush(const Subscription& subscription, const HistorySnapshot& snapshot,
+                              const std::vector<AlertEvent>& events, bool eventsComplete) const;
+
+    uint64_t pushedSequence_ = 0;           // tick last pushed; monitor thread only
+    uint64_t alertsPushed_ = 0;             // newest alert event pushed; monitor thread only
+
+    // Incremental GET_HISTORY: a cursor names a tick of this run, and the log maps recent
+    // tick sequences to their stamps. A service is sampled at most once per tick, so no raw
+    // ring has overwritten anything newer than a cursor that is still in the log.
+    struct TickLogEntry {
+        std::atomic<uint64_t> sequence{ 0 };
+        std::atomic<int64_t> wallMs{ 0 };
+    };
+    static constexpr size_t TickLogCapacity = ServiceHistory::RawCapacity;
+    int64_t runId_;                         // tells apart cursors from earlier runs
+    std::vector<TickLogEntry> tickLog_;     // by sequence % capacity
 };
 
 } // namespace smc
@@ -0,0 +1,166 @@
+#include "NamedPipeTransport.h"
+#include "Logger.h"
+
+namespace smc {
+
+namespace {
+
+constexpr ULONG_PTR WakeKey = 0;
+
+} // anonymous namespace
+
+struct NamedPipeTransport::Connection : IpcConnection {
+    ~Connection() override
+    {
+        if (pipe != INVALID_HANDLE_VALUE)
+            ::CloseHandle(pipe);
+    }
+
+    ULONG_PTR Key() { return reinterpret_cast<ULONG_PTR>(static_cast<IpcConnection*>(this)); }
+
+    OVERLAPPED overlapped{};
+    HANDLE pipe = INVALID_HANDLE_VALUE;
+};
+
+std::unique_ptr<IpcTransport> CreateIpcTransport()
+{
+    return std::make_unique<NamedPipeTransport>();
+}
+
+NamedPipeTransport::~NamedPipeTransport()
+{
+    Close();
+}
+
+bool NamedPipeTransport::Listen(const std::wstring& name)
+{
+    name_ = name;
+    iocp_ = ::CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0);
+    if (!iocp_) {
+        Logger::Error(L"CreateIoCompletionPort failed: " + std::to_wstring(::GetLastError()));
+        return false;
+    }
+    return true;
+}
+
+void NamedPipeTransport::Close()
+{
+    if (iocp_) {
+        ::CloseHandle(iocp_);
+        iocp_ = nullptr;
+    }
+}
+
+std::unique_ptr<IpcConnection> NamedPipeTransport::CreateConnection()
+{
+    auto conn = std::make_unique<Connection>();
+    conn->buffer.resize(MessageBufferBytes);
+    return conn;
+}
+
+bool NamedPipeTransport::Accept(IpcConnection& conn)
+{
+    auto& c = static_cast<Connection&>(conn);
+    if (c.pipe == INVALID_HANDLE_VALUE) {
+        // Security descriptor allowing local connections only
+        SECURITY_ATTRIBUTES sa{};
+        sa.nLength = sizeof(sa);
+        sa.bInheritHandle = FALSE;
+
+        c.pipe = ::CreateNamedPipeW(
+            name_.c_str(),
+            PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+            PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            PIPE_UNLIMITED_INSTANCES,
+            static_cast<DWORD>(PipeBufferBytes),      // output buffer
+            static_cast<DWORD>(PipeBufferBytes),      // input buffer
+            0,      // default timeout
+            &sa
+        );
+        if (c.pipe == INVALID_HANDLE_VALUE) {
+            Logger::Error(L"CreateNamedPipe failed: " + std::to_wstring(::GetLastError()));
+            return false;
+        }
+        ::CreateIoCompletionPort(c.pipe, iocp_, c.Key(), 0);
+    }
+
+    c.overlapped = OVERLAPPED{};
+    if (!::ConnectNamedPipe(c.pipe, &c.overlapped)) {
+        DWORD err = ::GetLastError();
+        if (err == ERROR_PIPE_CONNECTED) {
+            // The client beat us to it and no completion is queued; queue one ourselves
+            ::PostQueuedCompletionStatus(iocp_, 0, c.Key(), &c.overlapped);
+        }
+        else if (err != ERROR_IO_PENDING) {
+            Logger::Error(L"ConnectNamedPipe failed: " + std::to_wstring(err));
+            ::CloseHandle(c.pipe);
+            c.pipe = INVALID_HANDLE_VALUE;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool NamedPipeTransport::Read(IpcConnection& conn)
+{
+    auto& c = static_cast<Connection&>(conn);
+    c.overlapped = OVERLAPPED{};
+    if (::ReadFile(c.pipe, c.buffer.data(), static_cast<DWORD>(c.buffer.size()), nullptr, &c.overlapped))
+        return true;
+    // ERROR_MORE_DATA on the spot still queues a completion packet for this OVERLAPPED; the
+    // packet carries the partial read, so this must count as started like ERROR_IO_PENDING
+    DWORD err = ::GetLastError();
+    return err == ERROR_IO_PENDING || err == ERROR_MORE_DATA;
+}
+
+bool NamedPipeTransport::Write(IpcConnection& conn)
+{
+    auto& c = static_cast<Connection&>(conn);
+    c.overlapped = OVERLAPPED{};
+    const std::string& message = c.Outgoing();
+    return ::WriteFile(c.pipe, message.data(), static_cast<DWORD>(message.size()), nullptr, &c.overlapped)
+        || ::GetLastError() == ERROR_IO_PENDING;
+}
+
+void NamedPipeTransport::Cancel(IpcConnection& conn)
+{
+    auto& c = static_cast<Connection&>(conn);
+    if (c.pipe != INVALID_HANDLE_VALUE)
+        ::CancelIoEx(c.pipe, nullptr);
+}
+
+void NamedPipeTransport::Disconnect(IpcConnection& conn)
+{
+    auto& c = static_cast<Connection&>(conn);
+    if (c.pipe != INVALID_HANDLE_VALUE)
+        ::DisconnectNamedPipe(c.pipe);
+}
+
+bool NamedPipeTransport::Wait(IpcCompletion& completion)
+{
+    for (;;) {
+        DWORD bytes = 0;
+        ULONG_PTR key = WakeKey;
+        OVERLAPPED* overlapped = nullptr;
+        BOOL ok = ::GetQueuedCompletionStatus(iocp_, &bytes, &key, &overlapped, INFINITE);
+        if (!overlapped) {
+            if (key == WakeKey)
+                return false;
+            continue;
+        }
+
+        // A message longer than the read buffer fails the read with ERROR_MORE_DATA; the buffer
+        // is full and the rest stays in the pipe for the next ReadFile
+        bool more = !ok && ::GetLastError() == ERROR_MORE_DATA;
+        completion = { reinterpret_cast<IpcConnection*>(key), ok != FALSE || more, bytes, more };
+        return true;
+    }
+}
+
+void NamedPipeTransport::Wake(size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        ::PostQueuedCompletionStatus(iocp_, 0, WakeKey, nullptr);
+}
+
+} // namespace smc
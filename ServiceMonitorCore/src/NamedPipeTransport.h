@@ -0,0 +1,41 @@
+#pragma once
+
+#include "IpcTransport.h"
+
+#include <string>
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+namespace smc {
+
+/// IpcTransport over message-mode Named Pipes driven by an I/O completion port.
+/// Each connection owns one pipe instance, created on its first Accept() and reused
+/// across clients (DisconnectNamedPipe, then ConnectNamedPipe again). Messages longer than
+/// the read buffer arrive in pieces, reported by ERROR_MORE_DATA.
+class NamedPipeTransport : public IpcTransport {
+public:
+    ~NamedPipeTransport() override;
+
+    bool Listen(const std::wstring& name) override;
+    void Close() override;
+
+    std::unique_ptr<IpcConnection> CreateConnection() override;
+
+    bool Accept(IpcConnection& conn) override;
+    bool Read(IpcConnection& conn) override;
+    bool Write(IpcConnection& conn) override;
+    void Cancel(IpcConnection& conn) override;
+    void Disconnect(IpcConnection& conn) override;
+
+    bool Wait(IpcCompletion& completion) override;
+    void Wake(size_t count) override;
+
+private:
+    struct Connection;
+
+    std::wstring name_;
+    HANDLE iocp_ = nullptr;
+};
+
+} // namespace smc
@@ -1,22 +1,20 @@
 #include "PipeServer.h"
 #include "Logger.h"
 
-#include <memory>
-#include <vector>
+#include <algorithm>
+#include <cstring>
 
 namespace smc {
 
-PipeServer::PipeServer(const std::wstring& pipeName)
+PipeServer::PipeServer(const std::wstring& pipeName, std::unique_ptr<IpcTransport> transport)
     : pipeName_(pipeName)
+    , transport_(std::move(transport))
 {
-    stopEvent_ = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
 }
 
 PipeServer::~PipeServer()
 {
     Stop();
-    if (stopEvent_)
-        ::CloseHandle(stopEvent_);
 }
 
 void PipeServer::SetMessageHandler(MessageHandler handler)
@@ -29,124 +27,341 @@ void PipeServer::Start()
     if (running_.load())
         return;
 
+    if (!transport_->Listen(pipeName_)) {
+        Logger::Error(L"Cannot open IPC endpoint: " + pipeName_);
+        return;
+    }
+
     running_ = true;
-    ::ResetEvent(stopEvent_);
-    listenThread_ = std::thread(&PipeServer::ListenLoop, this);
+    for (size_t i = 0; i < ListenBacklog; ++i)
+        Listen();
+    for (size_t i = 0; i < IoThreads; ++i)
+        ioThreads_.emplace_back(&PipeServer::IoLoop, this);
 
     Logger::Info(L"Pipe server started: " + pipeName_);
 }
 
 void PipeServer::Stop()
 {
-    if (!running_.load())
+    if (!running_.exchange(false))
         return;
 
-    running_ = false;
-    ::SetEvent(stopEvent_);
+    // Cancel everything in flight, then let the I/O threads drain the aborted completions,
+    // so no connection is freed while the transport still owns its buffers
+    {
+        std::unique_lock lock(poolMutex_);
+        for (auto& conn : connections_) {
+            std::lock_guard io(conn->ioMutex);
+            transport_->Cancel(*conn);
+        }
+        drainedCv_.wait(lock, [this] { return pendingIo_.load() == 0; });
+    }
 
-    if (listenThread_.joinable())
-        listenThread_.join();
+    transport_->Wake(ioThreads_.size());
+    for (auto& thread : ioThreads_)
+        thread.join();
+    ioThreads_.clear();
+
+    {
+        // A Push() still running finishes before any connection is freed
+        std::lock_guard lock(subscribersMutex_);
+        subscribers_.clear();
+        subscriberCount_ = 0;
+    }
+
+    {
+        std::lock_guard lock(poolMutex_);
+        connections_.clear();
+        idle_.clear();
+    }
+    transport_->Close();
+    clients_ = 0;
+    listening_ = 0;
 
     Logger::Info(L"Pipe server stopped");
 }
 
-void PipeServer::ListenLoop()
-{
-    // Security descriptor allowing local connections only
-    SECURITY_ATTRIBUTES sa{};
-    sa.nLength = sizeof(sa);
-    sa.bInheritHandle = FALSE;
-
-    while (running_.load()) {
-        HANDLE pipe = ::CreateNamedPipeW(
-            pipeName_.c_str(),
-            PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
-            PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
-            PIPE_UNLIMITED_INSTANCES,
-            4096,   // output buffer
-            4096,   // input buffer
-            0,      // default timeout
-            &sa
-        );
-
-        if (pipe == INVALID_HANDLE_VALUE) {
-            Logger::Error(L"CreateNamedPipe failed: " + std::to_wstring(::GetLastError()));
-            ::Sleep(1000);
-            continue;
-        }
+std::string PipeServer::Dispatch(const std::string& request, IpcSession& session) const
+{
+    if (!messageHandler_)
+        return R"({"error":"no handler"})";
 
-        // Overlapped connect so we can check for stop signal
-        OVERLAPPED ol{};
-        ol.hEvent = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
-
-        BOOL connected = ::ConnectNamedPipe(pipe, &ol);
-        if (!connected) {
-            DWORD err = ::GetLastError();
-            if (err == ERROR_IO_PENDING) {
-                HANDLE waitHandles[] = { ol.hEvent, stopEvent_ };
-                DWORD waitResult = ::WaitForMultipleObjects(2, waitHandles, FALSE, INFINITE);
-
-                if (waitResult == WAIT_OBJECT_0 + 1) {
-                    // Stop requested
-                    ::CancelIo(pipe);
-                    ::CloseHandle(ol.hEvent);
-                    ::CloseHandle(pipe);
-                    break;
-                }
-            }
-            else if (err != ERROR_PIPE_CONNECTED) {
-                ::CloseHandle(ol.hEvent);
-                ::CloseHandle(pipe);
-                continue;
-            }
-        }
+    try {
+        return messageHandler_(request, session);
+    }
+    catch (const std::exception& ex) {
+        Logger::Error(L"Handler exception: " + std::wstring(ex.what(), ex.what() + strlen(ex.what())));
+        return R"({"error":")" + std::string(ex.what()) + R"("})";
+    }
+}
 
-        ::CloseHandle(ol.hEvent);
+IpcConnection* PipeServer::Acquire()
+{
+    std::lock_guard lock(poolMutex_);
+    if (!idle_.empty()) {
+        IpcConnection* conn = idle_.back();
+        idle_.pop_back();
+        return conn;
+    }
+    connections_.push_back(transport_->CreateConnection());
+    return connections_.back().get();
+}
+
+void PipeServer::Release(IpcConnection* conn)
+{
+    std::lock_guard lock(poolMutex_);
+    if (idle_.size() < MaxIdleConnections) {
+        idle_.push_back(conn);
+        return;
+    }
+
+    // The thread that started the last operation may still be leaving Begin()
+    { std::lock_guard io(conn->ioMutex); }
+    auto it = std::find_if(connections_.begin(), connections_.end(),
+                           [conn](const auto& owned) { return owned.get() == conn; });
+    if (it != connections_.end())
+        connections_.erase(it);
+}
+
+bool PipeServer::Begin(IpcConnection& conn, IpcConnection::Op op)
+{
+    // Under the connection's lock, so Stop() either sees this operation and cancels it
+    // or this sees the stop and starts nothing
+    std::lock_guard io(conn.ioMutex);
+    conn.op = op;
+    if (!running_.load())
+        return false;
 
-        // Handle client in the same thread (single-client model for simplicity)
-        HandleClient(pipe);
+    ++pendingIo_;
+    bool started = op == IpcConnection::Op::Accept ? transport_->Accept(conn)
+                 : op == IpcConnection::Op::Read   ? transport_->Read(conn)
+                                                   : transport_->Write(conn);
+    if (!started)
+        --pendingIo_;
+    return started;
+}
 
-        ::DisconnectNamedPipe(pipe);
-        ::CloseHandle(pipe);
+bool PipeServer::Listen(IpcConnection* reuse)
+{
+    IpcConnection* conn = reuse ? reuse : Acquire();
+    ++listening_;
+    if (!Begin(*conn, IpcConnection::Op::Accept)) {
+        --listening_;
+        Release(conn);
+        return false;
     }
+    return true;
 }
 
-void PipeServer::HandleClient(HANDLE pipe)
+void PipeServer::IoLoop()
 {
-    constexpr DWORD bufSize = 4096;
-    std::vector<char> buffer(bufSize);
+    IpcCompletion completion;
+    while (transport_->Wait(completion)) {
+        OnCompletion(*completion.connection, completion);
+
+        if (--pendingIo_ == 0 && !running_.load()) {
+            std::lock_guard lock(poolMutex_);
+            drainedCv_.notify_all();
+        }
+    }
+}
 
-    while (running_.load()) {
-        DWORD bytesRead = 0;
-        BOOL success = ::ReadFile(pipe, buffer.data(), bufSize, &bytesRead, nullptr);
+void PipeServer::OnCompletion(IpcConnection& conn, const IpcCompletion& completion)
+{
+    switch (conn.op) {
+    case IpcConnection::Op::Accept:
+        // Keep the backlog full before serving this client
+        --listening_;
+        if (running_.load())
+            Listen();
+        if (!completion.ok) {
+            Disconnect(conn);
+            return;
+        }
+        ++clients_;
+        conn.session = {};
+        if (!Begin(conn, IpcConnection::Op::Read))
+            Disconnect(conn);
+        return;
 
-        if (!success || bytesRead == 0) {
-            if (::GetLastError() == ERROR_BROKEN_PIPE) {
-                Logger::Info(L"Client disconnected");
+    case IpcConnection::Op::Read:
+        if (!completion.ok || completion.bytes == 0) {
+            Logger::Info(L"Client disconnected");
+            Disconnect(conn);
+            return;
+        }
+        conn.request.append(conn.buffer.data(), completion.bytes);
+        if (completion.more) {
+            // Keep reading the same message, within bounds
+            if (conn.request.size() >= IpcTransport::MaxMessageBytes) {
+                Logger::Error(L"Request exceeds the size limit, dropping client");
+                Disconnect(conn);
             }
-            break;
+            else if (!Begin(conn, IpcConnection::Op::Read)) {
+                Disconnect(conn);
+            }
+            return;
+        }
+        conn.response = Dispatch(conn.request, conn.session);
+        conn.request.clear();
+        if (conn.session.subscription)
+            Subscribe(conn);
+        if (!Begin(conn, IpcConnection::Op::Write))
+            Disconnect(conn);
+        return;
+
+    case IpcConnection::Op::Write:
+        if (!completion.ok) {
+            Disconnect(conn);
+            return;
+        }
+        if (conn.subscribed) {
+            PushNext(conn);
+            return;
         }
+        if (conn.session.nextMessage) {
+            bool more = false;
+            if (!Continue(conn, more)) {
+                Disconnect(conn);
+                return;
+            }
+            if (more) {
+                if (!Begin(conn, IpcConnection::Op::Write))
+                    Disconnect(conn);
+                return;
+            }
+        }
+        if (!Begin(conn, IpcConnection::Op::Read))
+            Disconnect(conn);
+        return;
+    }
+}
+
+bool PipeServer::Continue(IpcConnection& conn, bool& more) const
+{
+    try {
+        more = conn.session.nextMessage(conn.session, conn.response);
+    }
+    catch (const std::exception& ex) {
+        // Part of the response is out already, so the client cannot be answered cleanly
+        Logger::Error(L"Handler exception mid-response: " + std::wstring(ex.what(), ex.what() + strlen(ex.what())));
+        return false;
+    }
+    if (!more)
+        conn.session.nextMessage = nullptr;
+    return true;
+}
 
-        std::string request(buffer.data(), bytesRead);
+void PipeServer::Push(const std::function<SharedMessage(IpcSession& session)>& select)
+{
+    std::lock_guard lock(subscribersMutex_);
+    if (!running_.load())
+        return;
 
-        std::string response;
-        if (messageHandler_) {
+    for (size_t i = 0; i < subscribers_.size();) {
+        IpcConnection& conn = *subscribers_[i];
+        bool started = true;
+        {
+            std::lock_guard push(conn.pushMutex);
+            SharedMessage message;
             try {
-                response = messageHandler_(request);
+                message = select(conn.session);
             }
             catch (const std::exception& ex) {
-                response = R"({"error":")" + std::string(ex.what()) + R"("})";
-                Logger::Error(L"Handler exception: " + std::wstring(ex.what(), ex.what() + strlen(ex.what())));
+                Logger::Error(L"Push exception: " + std::wstring(ex.what(), ex.what() + strlen(ex.what())));
+            }
+
+            if (message && conn.pushing) {
+                // A slow client gets the newest messages; older ones still waiting are dropped
+                if (conn.pushQueue.size() >= MaxQueuedPushes)
+                    conn.pushQueue.pop_front();
+                conn.pushQueue.push_back(std::move(message));
+            }
+            else if (message) {
+                conn.pushing = true;
+                conn.pushed = std::move(message);
+                started = Begin(conn, IpcConnection::Op::Write);
             }
         }
-        else {
-            response = R"({"error":"no handler"})";
+        if (started) {
+            ++i;
+            continue;
+        }
+
+        // The client is gone, or the server is stopping
+        subscribers_.erase(subscribers_.begin() + static_cast<ptrdiff_t>(i));
+        conn.subscribed = false;
+        Disconnect(conn);
+    }
+    subscriberCount_ = subscribers_.size();
+}
+
+void PipeServer::Subscribe(IpcConnection& conn)
+{
+    // Marked as pushing for the reply, so pushes published meanwhile queue behind it
+    std::lock_guard lock(subscribersMutex_);
+    {
+        std::lock_guard push(conn.pushMutex);
+        conn.pushing = true;
+    }
+    conn.subscribed = true;
+    subscribers_.push_back(&conn);
+    subscriberCount_ = subscribers_.size();
+}
+
+void PipeServer::PushNext(IpcConnection& conn)
+{
+    {
+        std::lock_guard push(conn.pushMutex);
+        conn.response.clear();
+        conn.pushed.reset();
+        if (conn.pushQueue.empty()) {
+            conn.pushing = false;
+            return;
         }
+        conn.pushed = std::move(conn.pushQueue.front());
+        conn.pushQueue.pop_front();
+        if (Begin(conn, IpcConnection::Op::Write))
+            return;
+    }
+    Disconnect(conn);
+}
 
-        DWORD bytesWritten = 0;
-        ::WriteFile(pipe, response.c_str(), static_cast<DWORD>(response.size()), &bytesWritten, nullptr);
-        ::FlushFileBuffers(pipe);
+void PipeServer::Disconnect(IpcConnection& conn)
+{
+    if (conn.op != IpcConnection::Op::Accept)
+        --clients_;
+
+    // Off the subscriber list before the session goes; Push() already took it off if it
+    // is the caller
+    if (conn.subscribed) {
+        std::lock_guard lock(subscribersMutex_);
+        auto it = std::find(subscribers_.begin(), subscribers_.end(), &conn);
+        if (it != subscribers_.end())
+            subscribers_.erase(it);
+        subscriberCount_ = subscribers_.size();
+        conn.subscribed = false;
+    }
+    {
+        std::lock_guard push(conn.pushMutex);
+        conn.pushing = false;
+        conn.pushed.reset();
+        conn.pushQueue.clear();
     }
+    conn.request.clear();
+    conn.response.clear();
+    conn.session = {};      // drops whatever an unfinished response still holds
+    {
+        // Serialized with Stop() cancelling, which must not see a closed handle
+        std::lock_guard io(conn.ioMutex);
+        transport_->Disconnect(conn);
+    }
+
+    // A disconnected connection can take the next client; reuse it while the backlog is short
+    if (running_.load() && listening_.load() < ListenBacklog)
+        Listen(&conn);
+    else
+        Release(&conn);
 }
 
 } // namespace smc
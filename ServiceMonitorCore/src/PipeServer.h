@@ -1,48 +1,110 @@
 #pragma once
 
-#include <string>
-#include <functional>
-#include <thread>
+#include "IpcTransport.h"
+
 #include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
 #include <mutex>
-
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace smc {
 
-/// Asynchronous duplex Named Pipe server for IPC with the WPF UI.
-/// Protocol: JSON over UTF-8, newline-delimited messages.
+/// Duplex IPC server for the WPF UI, CLI scripts and health checks.
+/// Protocol: JSON over UTF-8, one message per request and per response. A client may
+/// negotiate binary response frames instead (see WireFormat.h); the handler keeps that
+/// choice in the connection's IpcSession.
+/// Requests longer than one read are reassembled, up to IpcTransport::MaxMessageBytes.
+/// A large response may go out as several messages produced one at a time by the
+/// session's nextMessage, so it is never held in memory whole.
+/// A request that sets the session's subscription turns its connection into a push stream:
+/// after the reply the server only writes, sending what Push() selects for it.
+/// The endpoint is an IpcTransport: a message-mode Named Pipe on Windows, an AF_UNIX
+/// SOCK_SEQPACKET socket elsewhere, so the server can be load-tested on Linux.
+/// Clients are served concurrently by a small fixed set of I/O threads waiting on the
+/// transport's completions. The handler runs on those threads, so it must be thread-safe.
+/// Per-connection state, including the pipe instance on Windows, is recycled through a pool.
 class PipeServer {
 public:
-    using MessageHandler = std::function<std::string(const std::string& requestJson)>;
+    using MessageHandler = std::function<std::string(const std::string& requestJson, IpcSession& session)>;
 
-    explicit PipeServer(const std::wstring& pipeName = L"\\\\.\\pipe\\ServiceMonitorPipe");
+    /// A pushed message, shared by every client it goes to.
+    using SharedMessage = std::shared_ptr<const std::string>;
+
+#ifdef _WIN32
+    static constexpr const wchar_t* DefaultPipeName = L"\\\\.\\pipe\\ServiceMonitorPipe";
+#else
+    static constexpr const wchar_t* DefaultPipeName = L"/tmp/ServiceMonitorPipe";
+#endif
+    static constexpr size_t IoThreads = 4;
+    static constexpr size_t ListenBacklog = 8;          // accepts kept pending
+    static constexpr size_t MaxIdleConnections = 64;    // pooled for reuse once their client leaves
+    static constexpr size_t MaxQueuedPushes = 4;        // per subscriber still writing; older ones are dropped
+
+    explicit PipeServer(const std::wstring& pipeName = DefaultPipeName,
+                        std::unique_ptr<IpcTransport> transport = CreateIpcTransport());
     ~PipeServer();
 
     PipeServer(const PipeServer&) = delete;
     PipeServer& operator=(const PipeServer&) = delete;
 
-    /// Set the handler that processes incoming JSON requests and returns JSON responses.
+    /// Set the handler that processes incoming JSON requests and returns the responses.
+    /// Call before Start().
     void SetMessageHandler(MessageHandler handler);
 
-    /// Start listening for client connections (non-blocking, runs in background thread).
+    /// Start listening for client connections (non-blocking, runs on the I/O threads).
     void Start();
 
-    /// Stop the pipe server.
+    /// Stop the server and disconnect every client.
     void Stop();
 
     bool IsRunning() const { return running_.load(); }
 
+    /// Clients connected right now.
+    size_t ClientCount() const { return clients_.load(); }
+
+    /// Offer a message to every subscribed client. `select` runs once per subscriber, under
+    /// its lock, and returns the message for it or null to skip it; subscribers wanting the
+    /// same content can share one serialization. Thread-safe.
+    void Push(const std::function<SharedMessage(IpcSession& session)>& select);
+
+    /// Clients subscribed right now.
+    size_t SubscriberCount() const { return subscriberCount_.load(); }
+
 private:
-    void ListenLoop();
-    void HandleClient(HANDLE pipe);
+    std::string Dispatch(const std::string& request, IpcSession& session) const;
+    bool Continue(IpcConnection& conn, bool& more) const;
+    IpcConnection* Acquire();
+    void Release(IpcConnection* conn);
+    bool Begin(IpcConnection& conn, IpcConnection::Op op);
+    bool Listen(IpcConnection* reuse = nullptr);
+    void IoLoop();
+    void OnCompletion(IpcConnection& conn, const IpcCompletion& completion);
+    void Disconnect(IpcConnection& conn);
+    void Subscribe(IpcConnection& conn);
+    void PushNext(IpcConnection& conn);
 
     std::wstring pipeName_;
+    std::unique_ptr<IpcTransport> transport_;
     MessageHandler messageHandler_;
-    std::thread listenThread_;
+    std::vector<std::thread> ioThreads_;
     std::atomic<bool> running_{ false };
-    HANDLE stopEvent_ = nullptr;
+    std::atomic<size_t> clients_{ 0 };
+    std::atomic<size_t> listening_{ 0 };
+    std::atomic<size_t> pendingIo_{ 0 };    // operations started and not yet completed
+
+    std::mutex poolMutex_;
+    std::condition_variable drainedCv_;
+    std::vector<std::unique_ptr<IpcConnection>> connections_;  // every live connection object
+    std::vector<IpcConnection*> idle_;
+
+    std::mutex subscribersMutex_;           // taken before a connection's pushMutex
+    std::vector<IpcConnection*> subscribers_;
+    std::atomic<size_t> subscriberCount_{ 0 };
 };
 
 } // namespace smc
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace smc {
+
+using ProcessId = uint32_t;
+
+/// Raw counters for one process, as read by a ProcessBackend.
+/// All times are in 100 ns units; sampleTime and creationTime share a backend-specific timebase.
+/// creationTime stays 0 when the process times could not be read.
+struct ProcessSample {
+    ProcessId processId = 0;
+    uint64_t sampleTime = 0;
+    uint64_t creationTime = 0;
+    uint64_t cpuTime = 0;          // kernel + user
+    uint64_t workingSetBytes = 0;
+};
+
+/// Platform abstraction over the per-process counter queries used by ResourceCollector.
+class ProcessBackend {
+public:
+    virtual ~ProcessBackend() = default;
+
+    /// Number of logical processors used to normalize CPU usage.
+    virtual int ProcessorCount() const = 0;
+
+    /// Read the counters of one process. Returns false if the process cannot be queried.
+    /// Safe to call concurrently from several threads.
+    virtual bool Sample(ProcessId processId, ProcessSample& sample) = 0;
+
+    /// Read the counters of every process on the system in one bulk pass.
+    /// `samples` is cleared and refilled so its capacity is reused across calls.
+    virtual bool SampleAll(std::vector<ProcessSample>& samples) = 0;
+};
+
+/// Create the backend for the platform this binary was built for.
+std::unique_ptr<ProcessBackend> CreateProcessBackend();
+
+} // namespace smc
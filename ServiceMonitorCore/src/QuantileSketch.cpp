@@ -0,0 +1,198 @@
+#include "QuantileSketch.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace smc {
+
+namespace {
+
+const double Gamma = (1.0 + QuantileSketch::RelativeAccuracy) / (1.0 - QuantileSketch::RelativeAccuracy);
+const double LogGamma = std::log(Gamma);
+
+int64_t FloorTo(int64_t value, int64_t width)
+{
+    int64_t q = value / width;
+    if (value % width < 0) --q;
+    return q * width;
+}
+
+} // anonymous namespace
+
+int32_t QuantileSketch::IndexOf(double value)
+{
+    return static_cast<int32_t>(std::ceil(std::log(value) / LogGamma));
+}
+
+double QuantileSketch::ValueOf(int32_t index)
+{
+    // Midpoint (in relative terms) of (gamma^(i-1), gamma^i]
+    return 2.0 * std::pow(Gamma, index) / (Gamma + 1.0);
+}
+
+void QuantileSketch::Reserve(int32_t low, int32_t high)
+{
+    if (!counts_.empty()) {
+        low = std::min(low, offset_);
+        high = std::max(high, HighIndex());
+    }
+    // Never keep more than MaxBuckets; indexes below the run are counted in its lowest bucket
+    low = std::max(low, high - MaxBuckets + 1);
+
+    if (counts_.empty()) {
+        offset_ = low;
+        counts_.assign(static_cast<size_t>(high - low + 1), 0);
+        return;
+    }
+
+    int32_t currentHigh = HighIndex();
+    if (low < offset_) {
+        counts_.insert(counts_.begin(), static_cast<size_t>(offset_ - low), 0);
+        offset_ = low;
+    }
+    if (high > currentHigh)
+        counts_.resize(counts_.size() + static_cast<size_t>(high - currentHigh), 0);
+
+    if (low > offset_) {
+        // The run grew upwards past MaxBuckets: collapse the lowest buckets into one
+        auto collapsed = static_cast<size_t>(low - offset_);
+        uint32_t folded = 0;
+        for (size_t i = 0; i < collapsed; ++i)
+            folded += counts_[i];
+        counts_.erase(counts_.begin(), counts_.begin() + static_cast<std::ptrdiff_t>(collapsed));
+        counts_[0] += folded;
+        offset_ = low;
+    }
+}
+
+void QuantileSketch::Add(double value)
+{
+    ++count_;
+    sum_ += value;
+    max_ = count_ == 1 ? value : std::max(max_, value);
+    if (value <= MinValue) {
+        ++zeroCount_;
+        return;
+    }
+
+    int32_t index = IndexOf(value);
+    Reserve(index, index);
+    ++counts_[static_cast<size_t>(std::max(index, offset_) - offset_)];
+}
+
+void QuantileSketch::Merge(const QuantileSketch& other)
+{
+    if (other.count_ == 0)
+        return;
+
+    max_ = count_ == 0 ? other.max_ : std::max(max_, other.max_);
+    count_ += other.count_;
+    sum_ += other.sum_;
+    zeroCount_ += other.zeroCount_;
+
+    if (other.counts_.empty())
+        return;
+
+    Reserve(other.offset_, other.HighIndex());
+    for (size_t i = 0; i < other.counts_.size(); ++i) {
+        int32_t index = std::max(other.offset_ + static_cast<int32_t>(i), offset_);
+        counts_[static_cast<size_t>(index - offset_)] += other.counts_[i];
+    }
+}
+
+void QuantileSketch::Clear()
+{
+    // clear() keeps the capacity, so a reused sketch rarely allocates
+    counts_.clear();
+    zeroCount_ = 0;
+    count_ = 0;
+    sum_ = 0.0;
+    max_ = 0.0;
+}
+
+double QuantileSketch::Quantile(double q) const
+{
+    if (count_ == 0)
+        return 0.0;
+
+    // Rank of the requested value, 0-based
+    auto rank = static_cast<uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(count_ - 1));
+    if (rank < zeroCount_)
+        return 0.0;
+
+    uint64_t seen = zeroCount_;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen > rank)
+            return std::min(ValueOf(offset_ + static_cast<int32_t>(i)), max_);
+    }
+    return max_;
+}
+
+SlidingQuantiles::SlidingQuantiles(int64_t subWindowMs, size_t subWindows)
+    : subWindowMs_(subWindowMs < 1 ? 1 : subWindowMs)
+    , subWindows_(subWindows < 1 ? 1 : subWindows)
+    , closed_(std::make_shared<const ClosedList>())
+{
+}
+
+void SlidingQuantiles::Add(int64_t timestampMs, double value)
+{
+    int64_t startMs = FloorTo(timestampMs, subWindowMs_);
+    if (startMs != openStartMs_)
+        Step(startMs);
+
+    std::lock_guard lock(openMutex_);
+    open_.Add(value);
+}
+
+void SlidingQuantiles::Step(int64_t startMs)
+{
+    // Only this thread changes the list and the open sketch, so both are read unlocked
+    // here; the copy is exact-size, unlike the open sketch's grown buffer
+    auto closed = std::make_shared<ClosedList>();
+    closed->reserve(subWindows_);
+    int64_t oldestMs = startMs - static_cast<int64_t>(subWindows_ - 1) * subWindowMs_;
+    for (const auto& entry : *closed_) {
+        if (entry.startMs >= oldestMs)
+            closed->push_back(entry);
+    }
+    if (openStartMs_ != INT64_MIN && openStartMs_ >= oldestMs)
+        closed->push_back({ openStartMs_, std::make_shared<const QuantileSketch>(open_) });
+
+    std::lock_guard lock(openMutex_);
+    closed_ = std::move(closed);
+    openStartMs_ = startMs;
+    open_.Clear();
+}
+
+void SlidingQuantiles::Query(int64_t nowMs, int64_t windowMs, QuantileSketch& out) const
+{
+    out.Clear();
+    auto closed = Snapshot([&](int64_t startMs, const QuantileSketch& open) {
+        if (InWindow(startMs, nowMs, windowMs))
+            out.Merge(open);
+    });
+    for (const auto& entry : *closed) {
+        if (InWindow(entry.startMs, nowMs, windowMs))
+            out.Merge(*entry.sketch);
+    }
+}
+
+double SlidingQuantiles::Mean(int64_t nowMs, int64_t windowMs) const
+{
+    double sum = 0.0;
+    uint64_t count = 0;
+    auto add = [&](int64_t startMs, const QuantileSketch& sketch) {
+        if (InWindow(startMs, nowMs, windowMs)) {
+            sum += sketch.Sum();
+            count += sketch.Count();
+        }
+    };
+    auto closed = Snapshot(add);
+    for (const auto& entry : *closed)
+        add(entry.startMs, *entry.sketch);
+    return count > 0 ? sum / static_cast<double>(count) : 0.0;
+}
+
+} // namespace smc
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace smc {
+
+/// DDSketch-style quantile sketch: positive values are counted in logarithmic buckets
+/// of ratio (1 + a) / (1 - a), so any quantile is answered within relative error a.
+/// Values at or below MinValue share one zero bucket. Add() is O(1) amortized; the
+/// buckets are one dense run of at most MaxBuckets ending at the highest index seen.
+/// Past that, the lowest buckets collapse into one, so quantiles within a factor of
+/// about 170 below the top keep the accuracy and lower ones are overestimated.
+/// Sketches with the same accuracy merge exactly, so windows can be assembled from parts.
+class QuantileSketch {
+public:
+    static constexpr double RelativeAccuracy = 0.01;
+    static constexpr double MinValue = 0.01;           // the raw ring's CPU resolution
+    static constexpr int32_t MaxBuckets = 256;
+
+    void Add(double value);
+    void Merge(const QuantileSketch& other);
+
+    /// Forget all values.
+    void Clear();
+
+    uint64_t Count() const { return count_; }
+    double Sum() const { return sum_; }
+    double Max() const { return max_; }
+
+    /// Value at quantile q in [0, 1]; 0 when empty.
+    double Quantile(double q) const;
+
+private:
+    static int32_t IndexOf(double value);
+    static double ValueOf(int32_t index);
+    void Reserve(int32_t low, int32_t high);
+    int32_t HighIndex() const { return offset_ + static_cast<int32_t>(counts_.size()) - 1; }
+
+    std::vector<uint32_t> counts_;      // counts_[i] is bucket offset_ + i; offset_ also holds all lower ones
+    int32_t offset_ = 0;
+    uint64_t zeroCount_ = 0;
+    uint64_t count_ = 0;
+    double sum_ = 0.0;
+    double max_ = 0.0;
+};
+
+/// Quantile sketch over a sliding time window, kept as `subWindows` sub-window
+/// sketches of `subWindowMs` each and merged on query. The window edge moves in whole
+/// sub-windows. Samples must arrive in time order.
+///
+/// Single writer: one thread calls Add(). Query() and Mean() may run on any thread.
+/// Closed sub-windows are immutable and published as a new list on each step, so
+/// they are merged without a lock; only the open sub-window is read under a mutex,
+/// which Add() holds just to count one value.
+class SlidingQuantiles {
+public:
+    SlidingQuantiles(int64_t subWindowMs, size_t subWindows);
+
+    void Add(int64_t timestampMs, double value);
+
+    /// Merge into `out` the sub-windows overlapping (nowMs - windowMs, nowMs].
+    /// windowMs should not exceed (subWindows - 1) * subWindowMs.
+    void Query(int64_t nowMs, int64_t windowMs, QuantileSketch& out) const;
+
+    /// Mean of the same sub-windows as Query(), without merging buckets; 0 when empty.
+    double Mean(int64_t nowMs, int64_t windowMs) const;
+
+private:
+    struct Closed {
+        int64_t startMs;
+        std::shared_ptr<const QuantileSketch> sketch;
+    };
+    using ClosedList = std::vector<Closed>;    // oldest first
+
+    bool InWindow(int64_t startMs, int64_t nowMs, int64_t windowMs) const
+    {
+        return startMs != INT64_MIN && startMs + subWindowMs_ > nowMs - windowMs && startMs <= nowMs;
+    }
+
+    void Step(int64_t startMs);
+
+    /// The closed list and, under the lock, fn(openStartMs, openSketch).
+    template <typename Fn>
+    std::shared_ptr<const ClosedList> Snapshot(Fn&& fn) const
+    {
+        std::lock_guard lock(openMutex_);
+        fn(openStartMs_, open_);
+        return closed_;
+    }
+
+    int64_t subWindowMs_;
+    size_t subWindows_;
+    mutable std::mutex openMutex_;              // guards the three members below
+    int64_t openStartMs_ = INT64_MIN;
+    QuantileSketch open_;
+    std::shared_ptr<const ClosedList> closed_;  // replaced on each step, never changed
+};
+
+} // namespace smc
@@ -1,97 +1,136 @@
 #include "ResourceCollector.h"
 #include "Logger.h"
+#include "WorkerPool.h"
 
+#include <algorithm>
 #include <memory>
 
-#pragma comment(lib, "pdh.lib")
-#pragma comment(lib, "psapi.lib")
-#pragma comment(lib, "advapi32.lib")
-
 namespace smc {
 
-ResourceCollector::ResourceCollector()
+ResourceCollector::ResourceCollector(std::unique_ptr<ProcessBackend> backend)
+    : backend_(std::move(backend))
 {
-    SYSTEM_INFO sysInfo{};
-    ::GetSystemInfo(&sysInfo);
-    numProcessors_ = static_cast<int>(sysInfo.dwNumberOfProcessors);
+    numProcessors_ = backend_->ProcessorCount();
     if (numProcessors_ < 1) numProcessors_ = 1;
 }
 
 ResourceCollector::~ResourceCollector() = default;
 
-ServiceMetrics ResourceCollector::Collect(DWORD processId)
+ServiceMetrics ResourceCollector::Collect(ProcessId processId)
 {
-    ServiceMetrics metrics{};
-
     if (processId == 0)
-        return metrics;
+        return {};
 
-    HANDLE hProcess = ::OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId);
-    if (!hProcess)
-        return metrics;
+    ProcessSample sample{};
+    if (!backend_->Sample(processId, sample))
+        return {};
 
-    // RAII handle wrapper
-    auto closer = std::unique_ptr<void, decltype(&::CloseHandle)>(hProcess, ::CloseHandle);
+    std::lock_guard lock(mutex_);
+    return ComputeMetrics(sample);
+}
 
-    // CPU usage (per-process state tracking)
-    metrics.cpuPercent = CalculateCpuUsage(hProcess, processId);
+bool ResourceCollector::TakeSnapshot()
+{
+    std::lock_guard batchLock(batchMutex_);
+    bool sampled = backend_->SampleAll(snapshotScratch_);
+    if (!sampled)
+        snapshotScratch_.clear();
+
+    std::sort(snapshotScratch_.begin(), snapshotScratch_.end(), [](const ProcessSample& a, const ProcessSample& b) {
+        return a.processId < b.processId;
+    });
+
+    std::lock_guard lock(mutex_);
+    snapshot_.swap(snapshotScratch_);
+    return sampled;
+}
 
-    // Memory usage
-    PROCESS_MEMORY_COUNTERS_EX pmc{};
-    pmc.cb = sizeof(pmc);
-    if (::GetProcessMemoryInfo(hProcess, reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&pmc), sizeof(pmc))) {
-        metrics.memoryMB = static_cast<double>(pmc.WorkingSetSize) / (1024.0 * 1024.0);
-    }
+ServiceMetrics ResourceCollector::CollectFromSnapshot(ProcessId processId)
+{
+    std::lock_guard lock(mutex_);
+    auto it = std::lower_bound(snapshot_.begin(), snapshot_.end(), processId,
+        [](const ProcessSample& sample, ProcessId pid) { return sample.processId < pid; });
 
-    // Uptime
-    FILETIME createTime{}, exitTime{}, kernelTime{}, userTime{};
-    if (::GetProcessTimes(hProcess, &createTime, &exitTime, &kernelTime, &userTime)) {
-        FILETIME nowFt{};
-        ::GetSystemTimeAsFileTime(&nowFt);
-
-        ULARGE_INTEGER start{}, now{};
-        start.LowPart = createTime.dwLowDateTime;
-        start.HighPart = createTime.dwHighDateTime;
-        now.LowPart = nowFt.dwLowDateTime;
-        now.HighPart = nowFt.dwHighDateTime;
-
-        metrics.uptimeSeconds = (now.QuadPart - start.QuadPart) / 10'000'000ULL;
+    if (processId == 0 || it == snapshot_.end() || it->processId != processId)
+        return {};
+
+    return ComputeMetrics(*it);
+}
+
+void ResourceCollector::CollectMany(std::span<const ProcessId> processIds, std::span<ServiceMetrics> metrics, WorkerPool* pool)
+{
+    std::lock_guard batchLock(batchMutex_);
+
+    size_t count = processIds.size();
+    batch_.resize(count);
+    batchValid_.assign(count, 0);
+
+    auto sampleOne = [&](size_t i) {
+        batchValid_[i] = processIds[i] != 0 && backend_->Sample(processIds[i], batch_[i]);
+    };
+
+    if (pool) {
+        pool->ParallelFor(count, sampleOne);
+    }
+    else {
+        for (size_t i = 0; i < count; ++i)
+            sampleOne(i);
     }
 
-    return metrics;
+    std::lock_guard lock(mutex_);
+    for (size_t i = 0; i < count; ++i)
+        metrics[i] = batchValid_[i] ? ComputeMetrics(batch_[i]) : ServiceMetrics{};
 }
 
-double ResourceCollector::CalculateCpuUsage(HANDLE hProcess, DWORD processId)
+void ResourceCollector::EndTick()
 {
-    FILETIME nowFt{}, creationFt{}, exitFt{}, kernelFt{}, userFt{};
-    ::GetSystemTimeAsFileTime(&nowFt);
+    std::lock_guard lock(mutex_);
+    cpuBaselines_.Sweep();
+}
 
-    if (!::GetProcessTimes(hProcess, &creationFt, &exitFt, &kernelFt, &userFt))
-        return 0.0;
+void ResourceCollector::SetBaselineRetention(uint32_t ticks)
+{
+    std::lock_guard lock(mutex_);
+    cpuBaselines_.SetMaxAge(ticks);
+}
+
+ServiceMetrics ResourceCollector::ComputeMetrics(const ProcessSample& sample)
+{
+    ServiceMetrics metrics{};
+
+    // Memory usage
+    metrics.memoryMB = static_cast<double>(sample.workingSetBytes) / (1024.0 * 1024.0);
+
+    if (sample.creationTime == 0)
+        return metrics;
+
+    // CPU usage (per-process state tracking)
+    metrics.cpuPercent = CalculateCpuUsage(sample);
+
+    // Uptime
+    if (sample.sampleTime > sample.creationTime)
+        metrics.uptimeSeconds = (sample.sampleTime - sample.creationTime) / 10'000'000ULL;
 
-    ULARGE_INTEGER now{}, kernel{}, user{};
-    now.LowPart = nowFt.dwLowDateTime;
-    now.HighPart = nowFt.dwHighDateTime;
-    kernel.LowPart = kernelFt.dwLowDateTime;
-    kernel.HighPart = kernelFt.dwHighDateTime;
-    user.LowPart = userFt.dwLowDateTime;
-    user.HighPart = userFt.dwHighDateTime;
+    return metrics;
+}
 
-    auto& state = cpuStates_[processId];
+double ResourceCollector::CalculateCpuUsage(const ProcessSample& sample)
+{
+    bool inserted = false;
+    auto& state = cpuBaselines_.Acquire(sample.processId, sample.creationTime, inserted);
 
-    if (state.lastTime.QuadPart == 0) {
-        state.lastTime = now;
-        state.lastKernel = kernel;
-        state.lastUser = user;
+    if (inserted) {
+        state.lastTime = sample.sampleTime;
+        state.lastCpu = sample.cpuTime;
         return 0.0;
     }
 
-    auto timeDelta = now.QuadPart - state.lastTime.QuadPart;
-    if (timeDelta == 0)
+    if (sample.sampleTime <= state.lastTime)
         return 0.0;
 
-    auto cpuDelta = (kernel.QuadPart - state.lastKernel.QuadPart) +
-                    (user.QuadPart - state.lastUser.QuadPart);
+    auto timeDelta = sample.sampleTime - state.lastTime;
+
+    auto cpuDelta = sample.cpuTime > state.lastCpu ? sample.cpuTime - state.lastCpu : 0;
 
     double percent = (static_cast<double>(cpuDelta) / static_cast<double>(timeDelta)) * 100.0 / numProcessors_;
 
@@ -99,90 +138,31 @@ double ResourceCollector::CalculateCpuUsage(HANDLE hProcess, DWORD processId)
     if (percent < 0.0) percent = 0.0;
     if (percent > 100.0) percent = 100.0;
 
-    state.lastTime = now;
-    state.lastKernel = kernel;
-    state.lastUser = user;
+    state.lastTime = sample.sampleTime;
+    state.lastCpu = sample.cpuTime;
 
     return percent;
 }
 
-DWORD ResourceCollector::GetServiceProcessId(const std::wstring& serviceName)
-{
-    SC_HANDLE scManager = ::OpenSCManagerW(nullptr, nullptr, SC_MANAGER_CONNECT);
-    if (!scManager)
-        return 0;
-
-    auto scmCloser = std::unique_ptr<SC_HANDLE__, decltype(&::CloseServiceHandle)>(scManager, ::CloseServiceHandle);
-
-    SC_HANDLE service = ::OpenServiceW(scManager, serviceName.c_str(), SERVICE_QUERY_STATUS);
-    if (!service)
-        return 0;
+#ifdef _WIN32
 
-    auto svcCloser = std::unique_ptr<SC_HANDLE__, decltype(&::CloseServiceHandle)>(service, ::CloseServiceHandle);
-
-    SERVICE_STATUS_PROCESS ssp{};
-    DWORD bytesNeeded = 0;
-    if (!::QueryServiceStatusEx(service, SC_STATUS_PROCESS_INFO,
-        reinterpret_cast<LPBYTE>(&ssp), sizeof(ssp), &bytesNeeded))
-        return 0;
-
-    return ssp.dwProcessId;
+ProcessId ResourceCollector::GetServiceProcessId(const std::wstring& serviceName)
+{
+    ServiceEntry entry{};
+    return scm_.Query(serviceName, entry) ? entry.processId : 0;
 }
 
 std::wstring ResourceCollector::GetServiceStatus(const std::wstring& serviceName)
 {
-    SC_HANDLE scManager = ::OpenSCManagerW(nullptr, nullptr, SC_MANAGER_CONNECT);
-    if (!scManager)
-        return L"Unknown";
-
-    auto scmCloser = std::unique_ptr<SC_HANDLE__, decltype(&::CloseServiceHandle)>(scManager, ::CloseServiceHandle);
-
-    SC_HANDLE service = ::OpenServiceW(scManager, serviceName.c_str(), SERVICE_QUERY_STATUS);
-    if (!service)
-        return L"Unknown";
-
-    auto svcCloser = std::unique_ptr<SC_HANDLE__, decltype(&::CloseServiceHandle)>(service, ::CloseServiceHandle);
-
-    SERVICE_STATUS_PROCESS ssp{};
-    DWORD bytesNeeded = 0;
-    if (!::QueryServiceStatusEx(service, SC_STATUS_PROCESS_INFO,
-        reinterpret_cast<LPBYTE>(&ssp), sizeof(ssp), &bytesNeeded))
-        return L"Unknown";
-
-    switch (ssp.dwCurrentState) {
-    case SERVICE_RUNNING:       return L"Running";
-    case SERVICE_STOPPED:       return L"Stopped";
-    case SERVICE_PAUSED:        return L"Paused";
-    case SERVICE_START_PENDING: return L"StartPending";
-    case SERVICE_STOP_PENDING:  return L"StopPending";
-    default:                    return L"Unknown";
-    }
+    ServiceEntry entry{};
+    return scm_.Query(serviceName, entry) ? ServiceStateName(entry.state) : L"Unknown";
 }
 
 std::wstring ResourceCollector::GetServiceExecutablePath(const std::wstring& serviceName)
 {
-    SC_HANDLE scManager = ::OpenSCManagerW(nullptr, nullptr, SC_MANAGER_CONNECT);
-    if (!scManager)
-        return {};
-
-    auto scmCloser = std::unique_ptr<SC_HANDLE__, decltype(&::CloseServiceHandle)>(scManager, ::CloseServiceHandle);
-
-    SC_HANDLE service = ::OpenServiceW(scManager, serviceName.c_str(), SERVICE_QUERY_CONFIG);
-    if (!service)
-        return {};
-
-    auto svcCloser = std::unique_ptr<SC_HANDLE__, decltype(&::CloseServiceHandle)>(service, ::CloseServiceHandle);
-
-    DWORD bytesNeeded = 0;
-    ::QueryServiceConfigW(service, nullptr, 0, &bytesNeeded);
-
-    auto buffer = std::make_unique<BYTE[]>(bytesNeeded);
-    auto config = reinterpret_cast<QUERY_SERVICE_CONFIGW*>(buffer.get());
-
-    if (!::QueryServiceConfigW(service, config, bytesNeeded, &bytesNeeded))
-        return {};
-
-    return config->lpBinaryPathName ? config->lpBinaryPathName : L"";
+    return scm_.GetExecutablePath(serviceName);
 }
 
+#endif // _WIN32
+
 } // namespace smc
@@ -1,16 +1,24 @@
 #pragma once
 
+#include "CpuBaselineTable.h"
+#include "ProcessBackend.h"
+#include "ServiceTypes.h"
+
+#ifdef _WIN32
+#include "ServiceControlManager.h"
+#endif
+
 #include <string>
 #include <cstdint>
-#include <unordered_map>
-
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-#include <Pdh.h>
-#include <Psapi.h>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
 
 namespace smc {
 
+class WorkerPool;
+
 /// Collects CPU and memory metrics for a target service process.
 struct ServiceMetrics {
     double cpuPercent = 0.0;
@@ -20,37 +28,76 @@ struct ServiceMetrics {
     std::wstring executablePath;
 };
 
+/// Thread-safe: the monitor loop and IPC handlers may collect concurrently.
 class ResourceCollector {
 public:
-    ResourceCollector();
+    explicit ResourceCollector(std::unique_ptr<ProcessBackend> backend = CreateProcessBackend());
     ~ResourceCollector();
 
     ResourceCollector(const ResourceCollector&) = delete;
     ResourceCollector& operator=(const ResourceCollector&) = delete;
 
     /// Collect metrics for a given process ID.
-    ServiceMetrics Collect(DWORD processId);
+    ServiceMetrics Collect(ProcessId processId);
+
+    /// Capture counters for every process in one bulk pass.
+    /// Returns false if the backend could not take a snapshot; callers fall back to Collect().
+    bool TakeSnapshot();
+
+    /// Collect metrics for a process from the last snapshot (zeros if it was not present).
+    ServiceMetrics CollectFromSnapshot(ProcessId processId);
+
+    /// Collect metrics for many processes, writing metrics[i] for processIds[i].
+    /// With a pool the per-process queries run in parallel; CPU baselines are then
+    /// updated on the calling thread, so workers never contend on shared state.
+    void CollectMany(std::span<const ProcessId> processIds, std::span<ServiceMetrics> metrics, WorkerPool* pool);
+
+    /// Mark the end of a collection tick; CPU baselines not refreshed for a few ticks are dropped.
+    void EndTick();
+
+    /// Keep CPU baselines for at least `ticks` ticks, so processes sampled less
+    /// often than every tick still get a CPU delta rather than a fresh baseline.
+    void SetBaselineRetention(uint32_t ticks);
+
+#ifdef _WIN32
+    /// Enumerate all active services with their PID and state in one call.
+    bool EnumerateServices(std::vector<ServiceEntry>& services) { return scm_.EnumerateActive(services); }
+
+    /// Query one service's PID and state. Returns false if it cannot be queried.
+    bool QueryService(const std::wstring& serviceName, ServiceEntry& entry) { return scm_.Query(serviceName, entry); }
 
     /// Get the process ID for a running service by name.
-    static DWORD GetServiceProcessId(const std::wstring& serviceName);
+    ProcessId GetServiceProcessId(const std::wstring& serviceName);
 
     /// Get service status string.
-    static std::wstring GetServiceStatus(const std::wstring& serviceName);
+    std::wstring GetServiceStatus(const std::wstring& serviceName);
 
     /// Get executable path for a service.
-    static std::wstring GetServiceExecutablePath(const std::wstring& serviceName);
+    std::wstring GetServiceExecutablePath(const std::wstring& serviceName);
+#endif
 
 private:
-    struct CpuState {
-        ULARGE_INTEGER lastTime{};
-        ULARGE_INTEGER lastKernel{};
-        ULARGE_INTEGER lastUser{};
-    };
+    /// Convert raw backend counters into metrics; shared by every backend.
+    ServiceMetrics ComputeMetrics(const ProcessSample& sample);
 
-    double CalculateCpuUsage(HANDLE hProcess, DWORD processId);
+    double CalculateCpuUsage(const ProcessSample& sample);
 
-    std::unordered_map<DWORD, CpuState> cpuStates_;
+    // Process queries run with no lock held. mutex_ covers only the CPU baselines and the
+    // published snapshot, so a single Collect() never waits for a whole batch of queries;
+    // batchMutex_ serializes the batch paths and their scratch buffers.
+    std::mutex mutex_;
+    std::mutex batchMutex_;
+    std::unique_ptr<ProcessBackend> backend_;
+    CpuBaselineTable cpuBaselines_;
+    std::vector<ProcessSample> snapshot_;   // sorted by processId
+    std::vector<ProcessSample> snapshotScratch_;
+    std::vector<ProcessSample> batch_;      // CollectMany scratch
+    std::vector<uint8_t> batchValid_;
     int numProcessors_ = 1;
+
+#ifdef _WIN32
+    ServiceControlManager scm_;
+#endif
 };
 
 } // namespace smc
@@ -0,0 +1,82 @@
+#include "SamplingScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace smc {
+
+SamplingScheduler::SamplingScheduler(const Options& options)
+    : options_(options)
+{
+    if (options_.maxIntervalTicks < 1)
+        options_.maxIntervalTicks = 1;
+}
+
+void SamplingScheduler::BeginTick()
+{
+    ++tick_;
+
+    {
+        std::lock_guard lock(watchMutex_);
+        watches_.swap(pendingWatches_);
+    }
+
+    for (ServiceId id : watches_) {
+        auto& state = StateFor(id);
+        state.watchedUntilTick = tick_ + options_.watchTicks;
+        state.intervalTicks = 1;
+        state.nextDueTick = std::min(state.nextDueTick, tick_);
+    }
+    watches_.clear();
+}
+
+SamplingScheduler::State& SamplingScheduler::StateFor(ServiceId id)
+{
+    // New services get a default state that is due immediately
+    if (id >= states_.size())
+        states_.resize(id + 1);
+    return states_[id];
+}
+
+bool SamplingScheduler::IsDue(ServiceId id, ProcessId processId)
+{
+    auto& state = StateFor(id);
+    if (state.processId != processId) {
+        // A new process has no CPU baseline yet and nothing to justify the old back-off
+        auto watchedUntilTick = state.watchedUntilTick;
+        state = State{};
+        state.watchedUntilTick = watchedUntilTick;
+        state.processId = processId;
+    }
+    if (!adaptive_)
+        return true;
+    return state.nextDueTick <= tick_;
+}
+
+void SamplingScheduler::Record(ServiceId id, double cpuPercent, double memoryMB)
+{
+    auto& state = StateFor(id);
+
+    bool active = cpuPercent >= options_.activeCpuPercent;
+    bool watched = state.watchedUntilTick > tick_;
+    bool volatileSample = state.lastCpu < 0.0 ||
+        std::fabs(cpuPercent - state.lastCpu) >= options_.cpuChangePercent ||
+        std::fabs(memoryMB - state.lastMemory) > state.lastMemory * options_.memoryChangeRatio;
+
+    if (active || watched || volatileSample)
+        state.intervalTicks = 1;
+    else
+        state.intervalTicks = std::min(state.intervalTicks * 2, options_.maxIntervalTicks);
+
+    state.lastCpu = cpuPercent;
+    state.lastMemory = memoryMB;
+    state.nextDueTick = tick_ + state.intervalTicks;
+}
+
+void SamplingScheduler::Watch(ServiceId id)
+{
+    std::lock_guard lock(watchMutex_);
+    pendingWatches_.push_back(id);
+}
+
+} // namespace smc
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ProcessBackend.h"
+#include "ServiceRegistry.h"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace smc {
+
+/// Decides which services are sampled on each monitoring tick.
+/// Every service starts at one sample per tick. Idle, stable services back off
+/// exponentially up to maxIntervalTicks; a service that is busy, changes
+/// noticeably, or is being watched by a client drops straight back to every tick.
+/// All methods except Watch() are for the monitor thread only.
+class SamplingScheduler {
+public:
+    struct Options {
+        uint32_t maxIntervalTicks = 32;
+        double activeCpuPercent = 5.0;      // at or above: sample every tick
+        double cpuChangePercent = 1.0;      // absolute change that counts as volatile
+        double memoryChangeRatio = 0.02;    // relative change that counts as volatile
+        uint32_t watchTicks = 30;           // how long a Watch() keeps a service fast
+    };
+
+    SamplingScheduler() : SamplingScheduler(Options{}) {}
+    explicit SamplingScheduler(const Options& options);
+
+    /// Advance to the next tick and apply pending Watch() requests.
+    void BeginTick();
+
+    /// True if the service should be sampled on the current tick. A service now hosted by
+    /// a different process than last time (restarted) starts over at every tick.
+    bool IsDue(ServiceId id, ProcessId processId);
+
+    /// Record a fresh sample and adapt the service's interval.
+    void Record(ServiceId id, double cpuPercent, double memoryMB);
+
+    /// Keep a service on the fastest interval for a while. Safe from any thread.
+    void Watch(ServiceId id);
+
+    /// Disable to sample every service on every tick.
+    void SetAdaptive(bool adaptive) { adaptive_ = adaptive; }
+    void SetMaxIntervalTicks(uint32_t ticks) { options_.maxIntervalTicks = ticks < 1 ? 1 : ticks; }
+    uint32_t MaxIntervalTicks() const { return options_.maxIntervalTicks; }
+
+private:
+    struct State {
+        uint64_t nextDueTick = 0;
+        uint64_t watchedUntilTick = 0;
+        uint32_t intervalTicks = 1;
+        double lastCpu = -1.0;
+        double lastMemory = -1.0;
+        ProcessId processId = 0;
+    };
+
+    State& StateFor(ServiceId id);
+
+    Options options_;
+    bool adaptive_ = true;
+    uint64_t tick_ = 0;
+    std::vector<State> states_;     // indexed by ServiceId
+
+    std::mutex watchMutex_;
+    std::vector<ServiceId> pendingWatches_;
+    std::vector<ServiceId> watches_;    // BeginTick scratch
+};
+
+} // namespace smc
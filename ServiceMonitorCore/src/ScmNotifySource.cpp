@@ -0,0 +1,313 @@
+#include "ScmNotifySource.h"
+#include "Logger.h"
+
+#pragma comment(lib, "advapi32.lib")
+
+namespace smc {
+
+namespace {
+
+constexpr DWORD AllStateNotifications =
+    SERVICE_NOTIFY_STOPPED | SERVICE_NOTIFY_START_PENDING | SERVICE_NOTIFY_STOP_PENDING |
+    SERVICE_NOTIFY_RUNNING | SERVICE_NOTIFY_CONTINUE_PENDING | SERVICE_NOTIFY_PAUSE_PENDING |
+    SERVICE_NOTIFY_PAUSED;
+
+/// SERVICE_NOTIFY_* bit for a SERVICE_* state (STOPPED = 1 -> 0x1, RUNNING = 4 -> 0x8, ...).
+DWORD NotifyMaskFor(ServiceState state)
+{
+    auto value = static_cast<DWORD>(state);
+    return (value >= 1 && value <= 7) ? (1u << (value - 1)) : 0;
+}
+
+} // anonymous namespace
+
+std::unique_ptr<ServiceStateSource> CreateServiceStateSource()
+{
+    return std::make_unique<ScmNotifySource>();
+}
+
+ScmNotifySource::ScmNotifySource()
+{
+    stopEvent_ = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    readyEvent_ = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+}
+
+ScmNotifySource::~ScmNotifySource()
+{
+    Stop();
+    if (stopEvent_) ::CloseHandle(stopEvent_);
+    if (readyEvent_) ::CloseHandle(readyEvent_);
+}
+
+bool ScmNotifySource::Start(ServiceStateSink& sink)
+{
+    if (thread_.joinable())
+        return started_;
+
+    sink_ = &sink;
+    started_ = false;
+    ::ResetEvent(stopEvent_);
+    ::ResetEvent(readyEvent_);
+
+    thread_ = std::thread(&ScmNotifySource::NotifyLoop, this);
+    ::WaitForSingleObject(readyEvent_, INFINITE);
+
+    if (!started_) {
+        thread_.join();
+        sink_ = nullptr;
+    }
+    return started_;
+}
+
+void ScmNotifySource::Stop()
+{
+    if (!thread_.joinable())
+        return;
+
+    ::SetEvent(stopEvent_);
+    thread_.join();
+    sink_ = nullptr;
+    started_ = false;
+}
+
+void ScmNotifySource::NotifyLoop()
+{
+    scm_.reset(::OpenSCManagerW(nullptr, nullptr, SC_MANAGER_CONNECT | SC_MANAGER_ENUMERATE_SERVICE));
+    if (!scm_ || !Resync()) {
+        scm_.reset();
+        ::SetEvent(readyEvent_);
+        return;
+    }
+
+    scmWatch_ = std::make_unique<Watch>();
+    scmWatch_->owner = this;
+    if (!Arm(*scmWatch_))
+        Logger::Error(L"SCM create/delete notifications unavailable");
+
+    started_ = true;
+    ::SetEvent(readyEvent_);
+
+    for (;;) {
+        DWORD result = ::WaitForSingleObjectEx(stopEvent_, INFINITE, TRUE);
+        if (result == WAIT_IO_COMPLETION) {
+            ProcessPending();
+            continue;
+        }
+        break;
+    }
+
+    // Closing the handles cancels every outstanding registration; no APC can
+    // run afterwards because this thread never waits alertably again.
+    pending_.clear();
+    watches_.clear();
+    retired_.clear();
+    scmWatch_.reset();
+    scm_.reset();
+}
+
+bool ScmNotifySource::Resync()
+{
+    DWORD bytesNeeded = 0, serviceCount = 0, resumeHandle = 0;
+    ::EnumServicesStatusExW(scm_.get(), SC_ENUM_PROCESS_INFO, SERVICE_WIN32, SERVICE_STATE_ALL,
+        nullptr, 0, &bytesNeeded, &serviceCount, &resumeHandle, nullptr);
+
+    std::vector<BYTE> buffer(bytesNeeded + 4096);
+    resumeHandle = 0;
+    if (!::EnumServicesStatusExW(scm_.get(), SC_ENUM_PROCESS_INFO, SERVICE_WIN32, SERVICE_STATE_ALL,
+        buffer.data(), static_cast<DWORD>(buffer.size()), &bytesNeeded, &serviceCount, &resumeHandle, nullptr))
+    {
+        Logger::Error(L"EnumServicesStatusEx failed: " + std::to_wstring(::GetLastError()));
+        return false;
+    }
+
+    std::vector<ServiceEntry> table;
+    table.reserve(serviceCount);
+    auto* entries = reinterpret_cast<const ENUM_SERVICE_STATUS_PROCESSW*>(buffer.data());
+    for (DWORD i = 0; i < serviceCount; ++i) {
+        ServiceEntry& entry = table.emplace_back();
+        entry.name = entries[i].lpServiceName;
+        entry.processId = entries[i].ServiceStatusProcess.dwProcessId;
+        entry.state = static_cast<ServiceState>(entries[i].ServiceStatusProcess.dwCurrentState);
+    }
+
+    sink_->OnServiceTable(table);
+
+    // Re-register every service from scratch so no watch keeps a stale "last state".
+    // The old registrations may still have APCs queued, so their watches are retired.
+    pending_.clear();
+    for (auto& [name, watch] : watches_)
+        Retire(std::move(watch));
+    watches_.clear();
+    for (const auto& entry : table)
+        WatchService(entry.name, entry.state);
+
+    resyncNeeded_ = false;
+    return true;
+}
+
+void ScmNotifySource::WatchService(const std::wstring& name, ServiceState currentState)
+{
+    SC_HANDLE service = ::OpenServiceW(scm_.get(), name.c_str(), SERVICE_QUERY_STATUS);
+    if (!service)
+        return;
+
+    auto watch = std::make_unique<Watch>();
+    watch->owner = this;
+    watch->name = name;
+    watch->handle.reset(service);
+    watch->lastState = currentState;
+
+    if (Arm(*watch)) {
+        Unwatch(name);
+        watches_[name] = std::move(watch);
+    }
+}
+
+void ScmNotifySource::Unwatch(const std::wstring& name)
+{
+    auto it = watches_.find(name);
+    if (it == watches_.end())
+        return;
+    Retire(std::move(it->second));
+    watches_.erase(it);
+}
+
+void ScmNotifySource::Retire(std::unique_ptr<Watch> watch)
+{
+    // Closing the handle cancels the registration, but its APC may already be queued.
+    // The watch is freed only after the next alertable wait has run any such APC.
+    watch->retired = true;
+    watch->handle.reset();
+    retired_.push_back(std::move(watch));
+}
+
+bool ScmNotifySource::Arm(Watch& watch)
+{
+    watch.notify = {};
+    watch.notify.dwVersion = SERVICE_NOTIFY_STATUS_CHANGE;
+    watch.notify.pfnNotifyCallback = &ScmNotifySource::OnNotify;
+    watch.notify.pContext = &watch;
+
+    SC_HANDLE handle = watch.name.empty() ? scm_.get() : watch.handle.get();
+
+    // A registration fires immediately if the service is already in a requested
+    // state, so ask only for transitions away from the state we last reported.
+    DWORD mask = watch.name.empty()
+        ? (SERVICE_NOTIFY_CREATED | SERVICE_NOTIFY_DELETED)
+        : ((AllStateNotifications & ~NotifyMaskFor(watch.lastState)) | SERVICE_NOTIFY_DELETE_PENDING);
+
+    DWORD err = ::NotifyServiceStatusChangeW(handle, mask, &watch.notify);
+    if (err == ERROR_SUCCESS) {
+        watch.armed = true;
+        return true;
+    }
+
+    if (err == ERROR_SERVICE_NOTIFY_CLIENT_LAGGING)
+        resyncNeeded_ = true;
+    else if (err == ERROR_SERVICE_MARKED_FOR_DELETE)
+        watch.deleted = true;
+    else
+        Logger::Error(L"NotifyServiceStatusChange failed: " + std::to_wstring(err));
+    return false;
+}
+
+void CALLBACK ScmNotifySource::OnNotify(PVOID parameter)
+{
+    auto* notify = static_cast<SERVICE_NOTIFYW*>(parameter);
+    auto* watch = static_cast<Watch*>(notify->pContext);
+    auto* self = watch->owner;
+    watch->armed = false;
+    if (watch->retired)
+        return;
+
+    if (notify->dwNotificationStatus == ERROR_SERVICE_MARKED_FOR_DELETE) {
+        watch->deleted = true;
+    }
+    else if (notify->dwNotificationStatus != ERROR_SUCCESS) {
+        self->resyncNeeded_ = true;
+    }
+    else if (watch->name.empty()) {
+        // MULTI_SZ of names; created services carry a '/' prefix, deleted ones none
+        if (notify->pszServiceNames) {
+            for (const wchar_t* name = notify->pszServiceNames; *name; name += wcslen(name) + 1) {
+                if (name[0] == L'/')
+                    self->created_.emplace_back(name + 1);
+                else
+                    self->deleted_.emplace_back(name);
+            }
+            ::LocalFree(notify->pszServiceNames);
+        }
+    }
+    else {
+        ServiceEntry entry{};
+        entry.name = watch->name;
+        entry.processId = notify->ServiceStatus.dwProcessId;
+        entry.state = static_cast<ServiceState>(notify->ServiceStatus.dwCurrentState);
+        watch->lastState = entry.state;
+        if (notify->dwNotificationTriggered & SERVICE_NOTIFY_DELETE_PENDING)
+            watch->deleted = true;
+        self->sink_->OnServiceChanged(entry);
+    }
+
+    self->pending_.push_back(watch);
+}
+
+void ScmNotifySource::ProcessPending()
+{
+    // The wait that led here ran every APC queued so far, including those of retired watches
+    retired_.clear();
+
+    if (resyncNeeded_) {
+        ResyncAndRearm();
+        return;
+    }
+
+    auto pending = std::move(pending_);
+    pending_.clear();
+
+    std::vector<std::wstring> removed;
+    for (Watch* watch : pending) {
+        if (watch->deleted)
+            removed.push_back(watch->name);
+        else if (!Arm(*watch) && watch->deleted)
+            removed.push_back(watch->name);
+    }
+
+    for (auto& name : deleted_)
+        removed.push_back(std::move(name));
+    deleted_.clear();
+
+    for (const auto& name : removed) {
+        if (name.empty()) continue;
+        Unwatch(name);
+        sink_->OnServiceRemoved(name);
+    }
+
+    for (const auto& name : created_) {
+        SERVICE_STATUS_PROCESS ssp{};
+        DWORD bytesNeeded = 0;
+        ScHandle service(::OpenServiceW(scm_.get(), name.c_str(), SERVICE_QUERY_STATUS));
+        if (!service || !::QueryServiceStatusEx(service.get(), SC_STATUS_PROCESS_INFO,
+            reinterpret_cast<LPBYTE>(&ssp), sizeof(ssp), &bytesNeeded))
+            continue;
+
+        ServiceEntry entry{ name, ssp.dwProcessId, static_cast<ServiceState>(ssp.dwCurrentState) };
+        sink_->OnServiceChanged(entry);
+        WatchService(name, entry.state);
+    }
+    created_.clear();
+
+    if (resyncNeeded_)
+        ResyncAndRearm();
+}
+
+void ScmNotifySource::ResyncAndRearm()
+{
+    created_.clear();
+    deleted_.clear();
+    Resync();
+    if (scmWatch_ && !scmWatch_->armed)
+        Arm(*scmWatch_);
+}
+
+} // namespace smc
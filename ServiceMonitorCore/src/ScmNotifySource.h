@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ServiceStateSource.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+namespace smc {
+
+/// ServiceStateSource backed by NotifyServiceStatusChange.
+/// A dedicated thread owns every SCM/service handle and waits alertably, so the
+/// SCM's notification APCs run there; each one-shot registration is re-armed
+/// after its callback returns.
+class ScmNotifySource : public ServiceStateSource {
+public:
+    ScmNotifySource();
+    ~ScmNotifySource() override;
+
+    ScmNotifySource(const ScmNotifySource&) = delete;
+    ScmNotifySource& operator=(const ScmNotifySource&) = delete;
+
+    bool Start(ServiceStateSink& sink) override;
+    void Stop() override;
+
+private:
+    struct HandleCloser {
+        void operator()(SC_HANDLE handle) const { ::CloseServiceHandle(handle); }
+    };
+    using ScHandle = std::unique_ptr<SC_HANDLE__, HandleCloser>;
+
+    /// Per-registration state. Heap-allocated so SERVICE_NOTIFYW stays at a stable address.
+    struct Watch {
+        ScmNotifySource* owner = nullptr;
+        std::wstring name;              // empty for the SCM-level create/delete watch
+        ScHandle handle;
+        SERVICE_NOTIFYW notify{};
+        ServiceState lastState = ServiceState::Unknown;
+        bool armed = false;
+        bool deleted = false;
+        bool retired = false;           // handle closed; kept alive for a queued APC
+    };
+
+    static void CALLBACK OnNotify(PVOID parameter);
+
+    void NotifyLoop();
+    bool Resync();
+    void WatchService(const std::wstring& name, ServiceState currentState);
+    void Unwatch(const std::wstring& name);
+    void Retire(std::unique_ptr<Watch> watch);
+    bool Arm(Watch& watch);
+    void ProcessPending();
+    void ResyncAndRearm();
+
+    ServiceStateSink* sink_ = nullptr;
+    std::thread thread_;
+    HANDLE stopEvent_ = nullptr;
+    HANDLE readyEvent_ = nullptr;
+    bool started_ = false;
+
+    // Owned by the notify thread
+    ScHandle scm_;
+    std::unique_ptr<Watch> scmWatch_;
+    std::unordered_map<std::wstring, std::unique_ptr<Watch>> watches_;
+    std::vector<Watch*> pending_;           // fired registrations awaiting re-arm
+    std::vector<std::unique_ptr<Watch>> retired_;   // freed after the next alertable drain
+    std::vector<std::wstring> created_;
+    std::vector<std::wstring> deleted_;
+    bool resyncNeeded_ = false;
+};
+
+} // namespace smc
@@ -0,0 +1,170 @@
+#include "ServiceControlManager.h"
+#include "Logger.h"
+
+#pragma comment(lib, "advapi32.lib")
+
+namespace smc {
+
+namespace {
+
+/// Errors that mean a cached handle is no longer usable and should be reopened.
+bool IsStaleHandleError(DWORD err)
+{
+    return err == ERROR_INVALID_HANDLE ||
+           err == ERROR_SERVICE_MARKED_FOR_DELETE ||
+           err == ERROR_SERVICE_DOES_NOT_EXIST ||
+           err == RPC_S_SERVER_UNAVAILABLE ||
+           err == RPC_S_CALL_FAILED;
+}
+
+} // anonymous namespace
+
+bool ServiceControlManager::EnumerateActive(std::vector<ServiceEntry>& services)
+{
+    std::lock_guard lock(mutex_);
+
+    // First call sizes the buffer; one more covers a stale SCM connection
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        SC_HANDLE scm = ConnectionUnlocked();
+        if (!scm)
+            break;
+
+        DWORD bytesNeeded = 0, serviceCount = 0, resumeHandle = 0;
+        BOOL ok = ::EnumServicesStatusExW(scm, SC_ENUM_PROCESS_INFO, SERVICE_WIN32, SERVICE_ACTIVE,
+            enumBuffer_.data(), static_cast<DWORD>(enumBuffer_.size()),
+            &bytesNeeded, &serviceCount, &resumeHandle, nullptr);
+
+        if (!ok) {
+            DWORD err = ::GetLastError();
+            if (err == ERROR_MORE_DATA) {
+                // Grow with headroom for services starting between calls, then retry from the start
+                enumBuffer_.resize(enumBuffer_.size() + bytesNeeded + 4096);
+                continue;
+            }
+            if (IsStaleHandleError(err)) {
+                scm_.reset();
+                services_.clear();
+                continue;
+            }
+            Logger::Error(L"EnumServicesStatusEx failed: " + std::to_wstring(err));
+            break;
+        }
+
+        // Entries are overwritten in place, so the names reuse their buffers every tick
+        auto* entries = reinterpret_cast<const ENUM_SERVICE_STATUS_PROCESSW*>(enumBuffer_.data());
+        services.resize(serviceCount);
+        for (DWORD i = 0; i < serviceCount; ++i) {
+            ServiceEntry& entry = services[i];
+            entry.name.assign(entries[i].lpServiceName);
+            entry.processId = entries[i].ServiceStatusProcess.dwProcessId;
+            entry.state = static_cast<ServiceState>(entries[i].ServiceStatusProcess.dwCurrentState);
+        }
+        return true;
+    }
+
+    services.clear();
+    return false;
+}
+
+bool ServiceControlManager::Query(const std::wstring& serviceName, ServiceEntry& entry)
+{
+    std::lock_guard lock(mutex_);
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        SC_HANDLE service = ServiceUnlocked(serviceName);
+        if (!service)
+            return false;
+
+        SERVICE_STATUS_PROCESS ssp{};
+        DWORD bytesNeeded = 0;
+        if (::QueryServiceStatusEx(service, SC_STATUS_PROCESS_INFO,
+            reinterpret_cast<LPBYTE>(&ssp), sizeof(ssp), &bytesNeeded))
+        {
+            entry.name = serviceName;
+            entry.processId = ssp.dwProcessId;
+            entry.state = static_cast<ServiceState>(ssp.dwCurrentState);
+            return true;
+        }
+
+        if (!IsStaleHandleError(::GetLastError()))
+            return false;
+        DropServiceUnlocked(serviceName);
+    }
+
+    return false;
+}
+
+std::wstring ServiceControlManager::GetExecutablePath(const std::wstring& serviceName)
+{
+    std::lock_guard lock(mutex_);
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        SC_HANDLE service = ServiceUnlocked(serviceName);
+        if (!service)
+            return {};
+
+        DWORD bytesNeeded = 0;
+        if (configBuffer_.size() < sizeof(QUERY_SERVICE_CONFIGW))
+            configBuffer_.resize(1024);
+
+        auto* config = reinterpret_cast<QUERY_SERVICE_CONFIGW*>(configBuffer_.data());
+        if (!::QueryServiceConfigW(service, config, static_cast<DWORD>(configBuffer_.size()), &bytesNeeded)) {
+            DWORD err = ::GetLastError();
+            if (err == ERROR_INSUFFICIENT_BUFFER) {
+                configBuffer_.resize(bytesNeeded);
+                config = reinterpret_cast<QUERY_SERVICE_CONFIGW*>(configBuffer_.data());
+                if (!::QueryServiceConfigW(service, config, bytesNeeded, &bytesNeeded))
+                    return {};
+            }
+            else if (IsStaleHandleError(err)) {
+                DropServiceUnlocked(serviceName);
+                continue;
+            }
+            else {
+                return {};
+            }
+        }
+
+        return config->lpBinaryPathName ? config->lpBinaryPathName : L"";
+    }
+
+    return {};
+}
+
+SC_HANDLE ServiceControlManager::ConnectionUnlocked()
+{
+    if (!scm_) {
+        scm_.reset(::OpenSCManagerW(nullptr, nullptr, SC_MANAGER_CONNECT | SC_MANAGER_ENUMERATE_SERVICE));
+        if (!scm_)
+            Logger::Error(L"OpenSCManager failed: " + std::to_wstring(::GetLastError()));
+    }
+    return scm_.get();
+}
+
+SC_HANDLE ServiceControlManager::ServiceUnlocked(const std::wstring& serviceName)
+{
+    auto it = services_.find(serviceName);
+    if (it != services_.end())
+        return it->second.get();
+
+    SC_HANDLE scm = ConnectionUnlocked();
+    if (!scm)
+        return nullptr;
+
+    SC_HANDLE service = ::OpenServiceW(scm, serviceName.c_str(), SERVICE_QUERY_STATUS | SERVICE_QUERY_CONFIG);
+    if (!service) {
+        DWORD err = ::GetLastError();
+        if (err == ERROR_INVALID_HANDLE || err == RPC_S_SERVER_UNAVAILABLE || err == RPC_S_CALL_FAILED)
+            scm_.reset();
+        return nullptr;
+    }
+
+    return services_.emplace(serviceName, ScHandle(service)).first->second.get();
+}
+
+void ServiceControlManager::DropServiceUnlocked(const std::wstring& serviceName)
+{
+    services_.erase(serviceName);
+}
+
+} // namespace smc
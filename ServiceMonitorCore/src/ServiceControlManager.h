@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ServiceTypes.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+namespace smc {
+
+/// Persistent SCM connection with a per-service handle cache.
+/// Opening the SCM and a service costs two RPC round-trips; both handles are kept
+/// for the lifetime of this object and reopened only when they go stale.
+class ServiceControlManager {
+public:
+    ServiceControlManager() = default;
+
+    ServiceControlManager(const ServiceControlManager&) = delete;
+    ServiceControlManager& operator=(const ServiceControlManager&) = delete;
+
+    /// Enumerate every active Win32 service (name, PID, state) in one EnumServicesStatusEx call.
+    /// `services` is refilled in place, so its entries' name buffers are reused across calls;
+    /// it is left empty on failure.
+    bool EnumerateActive(std::vector<ServiceEntry>& services);
+
+    /// Query one service's PID and state. Returns false if the service cannot be queried.
+    bool Query(const std::wstring& serviceName, ServiceEntry& entry);
+
+    /// Get the configured binary path of a service.
+    std::wstring GetExecutablePath(const std::wstring& serviceName);
+
+private:
+    struct HandleCloser {
+        void operator()(SC_HANDLE handle) const { ::CloseServiceHandle(handle); }
+    };
+    using ScHandle = std::unique_ptr<SC_HANDLE__, HandleCloser>;
+
+    SC_HANDLE ConnectionUnlocked();
+    SC_HANDLE ServiceUnlocked(const std::wstring& serviceName);
+    void DropServiceUnlocked(const std::wstring& serviceName);
+
+    std::mutex mutex_;
+    ScHandle scm_;
+    std::unordered_map<std::wstring, ScHandle> services_;
+    std::vector<BYTE> enumBuffer_;
+    std::vector<BYTE> configBuffer_;
+};
+
+} // namespace smc
@@ -0,0 +1,244 @@
+#include "ServiceHistory.h"
+
+#include <algorithm>
+
+namespace smc {
+
+namespace {
+
+int64_t FloorTo(int64_t value, int64_t width)
+{
+    int64_t q = value / width;
+    if (value % width < 0) --q;
+    return q * width;
+}
+
+// Sketch sub-windows: enough slots that a full window plus the open step is retained
+constexpr int64_t FineStepMs = 10'000;
+constexpr size_t FineSlots = 7;             // 1 min
+constexpr int64_t CoarseStepMs = 60'000;
+constexpr size_t CoarseSlots = 61;          // 1 h
+
+template <typename T>
+void StoreRelaxed(T& target, T value)
+{
+    std::atomic_ref<T>(target).store(value, std::memory_order_relaxed);
+}
+
+template <typename T>
+T LoadRelaxed(const T& source)
+{
+    return std::atomic_ref<T>(const_cast<T&>(source)).load(std::memory_order_relaxed);
+}
+
+
+} // anonymous namespace
+
+RollupTier::RollupTier(int64_t widthMs, size_t blockCount)
+    : widthMs_(widthMs)
+    , sealed_(Columns, blockCount)
+{
+}
+
+RollupTier::RollupTier(int64_t widthMs, size_t blockCount, const CompressedSeries::Region& region)
+    : widthMs_(widthMs)
+    , sealed_(Columns, blockCount, region)
+{
+}
+
+void RollupTier::Add(int64_t timestampMs, double cpuPercent, double memoryMB)
+{
+    int64_t startMs = FloorTo(timestampMs, widthMs_);
+    Accumulator next = open_;
+    if (next.count > 0 && startMs != next.startMs) {
+        // The sealed bucket stays readable as open_ until the next one is published
+        Seal();
+        next.count = 0;
+    }
+
+    if (next.count == 0) {
+        next.startMs = startMs;
+        next.cpuMin = next.cpuMax = cpuPercent;
+        next.memoryMin = next.memoryMax = memoryMB;
+        next.cpuSum = next.memorySum = 0.0;
+    }
+
+    ++next.count;
+    next.cpuMin = std::min(next.cpuMin, cpuPercent);
+    next.cpuMax = std::max(next.cpuMax, cpuPercent);
+    next.cpuSum += cpuPercent;
+    next.cpuLast = cpuPercent;
+    next.memoryMin = std::min(next.memoryMin, memoryMB);
+    next.memoryMax = std::max(next.memoryMax, memoryMB);
+    next.memorySum += memoryMB;
+    next.memoryLast = memoryMB;
+    PublishOpen(next);
+}
+
+void RollupTier::PublishOpen(const Accumulator& value)
+{
+    uint64_t version = openVersion_.load(std::memory_order_relaxed);
+    openVersion_.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    StoreRelaxed(open_.startMs, value.startMs);
+    StoreRelaxed(open_.count, value.count);
+    for (auto field : AccumulatorFields)
+        StoreRelaxed(open_.*field, value.*field);
+
+    openVersion_.store(version + 2, std::memory_order_release);
+}
+
+RollupTier::Accumulator RollupTier::CopyOpen() const
+{
+    Accumulator copy;
+    for (;;) {
+        uint64_t version = openVersion_.load(std::memory_order_acquire);
+        if (version & 1)
+            continue;
+
+        copy.startMs = LoadRelaxed(open_.startMs);
+        copy.count = LoadRelaxed(open_.count);
+        for (auto field : AccumulatorFields)
+            copy.*field = LoadRelaxed(open_.*field);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (openVersion_.load(std::memory_order_relaxed) == version)
+            return copy;
+    }
+}
+
+void RollupTier::Seal()
+{
+    auto point = open_.Point();
+    uint32_t values[Columns] = {
+        CpuCodec::Encode(point.cpuMin),
+        CpuCodec::Encode(point.cpuMax),
+        CpuCodec::Encode(point.cpuAvg),
+        CpuCodec::Encode(point.cpuLast),
+        MemoryCodec::Encode(point.memoryMin),
+        MemoryCodec::Encode(point.memoryMax),
+        MemoryCodec::Encode(point.memoryAvg),
+        MemoryCodec::Encode(point.memoryLast),
+    };
+    sealed_.Append(point.startMs, values);
+}
+
+ServiceHistory::ServiceHistory()
+    : raw_(RawCapacity)
+    , tenSeconds_(TenSecondsMs, TenSecondBlocks)
+    , oneMinute_(OneMinuteMs, OneMinuteBlocks)
+    , cpuFine_(FineStepMs, FineSlots)
+    , cpuCoarse_(CoarseStepMs, CoarseSlots)
+    , memoryFine_(FineStepMs, FineSlots)
+    , memoryCoarse_(CoarseStepMs, CoarseSlots)
+{
+}
+
+ServiceHistory::ServiceHistory(const Region& region)
+    : raw_(RawCapacity, region.raw)
+    , tenSeconds_(TenSecondsMs, TenSecondBlocks, region.tenSeconds)
+    , oneMinute_(OneMinuteMs, OneMinuteBlocks, region.oneMinute)
+    , cpuFine_(FineStepMs, FineSlots)
+    , cpuCoarse_(CoarseStepMs, CoarseSlots)
+    , memoryFine_(FineStepMs, FineSlots)
+    , memoryCoarse_(CoarseStepMs, CoarseSlots)
+{
+    if (raw_.Empty())
+        return;
+
+    int64_t tenSecondsFromMs = tenSeconds_.UnsealedFromMs();
+    int64_t oneMinuteFromMs = oneMinute_.UnsealedFromMs();
+    int64_t sketchesFromMs = raw_.LatestTimestampMs() - static_cast<int64_t>(CoarseSlots) * CoarseStepMs;
+    int64_t fromMs = std::min({ tenSecondsFromMs, oneMinuteFromMs, sketchesFromMs });
+
+    for (const auto& segment : raw_.Range(fromMs, std::numeric_limits<int64_t>::max())) {
+        for (size_t i = 0; i < segment.timestampsMs.size(); ++i) {
+            int64_t timestampMs = segment.timestampsMs[i];
+            double cpuPercent = HistoryRing::CpuCodec::Decode(segment.cpu[i]);
+            double memoryMB = HistoryRing::MemoryCodec::Decode(segment.memory[i]);
+            if (timestampMs >= tenSecondsFromMs)
+                tenSeconds_.Add(timestampMs, cpuPercent, memoryMB);
+            if (timestampMs >= oneMinuteFromMs)
+                oneMinute_.Add(timestampMs, cpuPercent, memoryMB);
+            if (timestampMs >= sketchesFromMs) {
+                cpuFine_.Add(timestampMs, cpuPercent);
+                cpuCoarse_.Add(timestampMs, cpuPercent);
+                memoryFine_.Add(timestampMs, memoryMB);
+                memoryCoarse_.Add(timestampMs, memoryMB);
+            }
+        }
+    }
+}
+
+void ServiceHistory::Push(int64_t timestampMs, double cpuPercent, double memoryMB)
+{
+    raw_.Push(timestampMs, cpuPercent, memoryMB);
+    AddSummaries(timestampMs, cpuPercent, memoryMB);
+}
+
+void ServiceHistory::AddSummaries(int64_t timestampMs, double cpuPercent, double memoryMB)
+{
+    tenSeconds_.Add(timestampMs, cpuPercent, memoryMB);
+    oneMinute_.Add(timestampMs, cpuPercent, memoryMB);
+    cpuFine_.Add(timestampMs, cpuPercent);
+    cpuCoarse_.Add(timestampMs, cpuPercent);
+    memoryFine_.Add(timestampMs, memoryMB);
+    memoryCoarse_.Add(timestampMs, memoryMB);
+}
+
+void ServiceHistory::CopyRollup(Resolution resolution, int64_t fromMs, int64_t toMs, std::vector<RollupPoint>& out) const
+{
+    out.clear();
+    Rollup(resolution).ForEachInRange(fromMs, toMs, [&](const RollupPoint& point) { out.push_back(point); });
+}
+
+void ServiceHistory::GetStats(StatsWindow window, int64_t nowMs, Quantiles& cpu, Quantiles& memory) const
+{
+    int64_t windowMs = WindowMs(window);
+    bool fine = window == StatsWindow::OneMinute;
+
+    QuantileSketch cpuSketch;
+    QuantileSketch memorySketch;
+    (fine ? cpuFine_ : cpuCoarse_).Query(nowMs, windowMs, cpuSketch);
+    (fine ? memoryFine_ : memoryCoarse_).Query(nowMs, windowMs, memorySketch);
+
+    auto summarize = [](const QuantileSketch& sketch, Quantiles& out) {
+        out.count = sketch.Count();
+        out.p50 = sketch.Quantile(0.50);
+        out.p95 = sketch.Quantile(0.95);
+        out.p99 = sketch.Quantile(0.99);
+        out.max = sketch.Max();
+    };
+    summarize(cpuSketch, cpu);
+    summarize(memorySketch, memory);
+}
+
+void ServiceHistory::GetMeans(StatsWindow window, int64_t nowMs, double& cpu, double& memory) const
+{
+    int64_t windowMs = WindowMs(window);
+    bool fine = window == StatsWindow::OneMinute;
+
+    cpu = (fine ? cpuFine_ : cpuCoarse_).Mean(nowMs, windowMs);
+    memory = (fine ? memoryFine_ : memoryCoarse_).Mean(nowMs, windowMs);
+}
+
+int64_t ServiceHistory::WindowMs(StatsWindow window)
+{
+    switch (window) {
+    case StatsWindow::OneMinute:      return 60'000;
+    case StatsWindow::FifteenMinutes: return 15 * 60'000;
+    default:                          return 60 * 60'000;
+    }
+}
+
+ServiceHistory::Resolution ServiceHistory::SelectResolution(int64_t rangeMs)
+{
+    if (rangeMs <= RawSpanMs)
+        return Resolution::Raw;
+    if (rangeMs <= TenSecondsMs * static_cast<int64_t>(TenSecondBuckets))
+        return Resolution::TenSeconds;
+    return Resolution::OneMinute;
+}
+
+} // namespace smc
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "CompressedSeries.h"
+#include "HistoryRing.h"
+#include "QuantileSketch.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace smc {
+
+/// Aggregate of the samples that fell into one fixed-width time bucket, decoded.
+struct RollupPoint {
+    int64_t startMs = 0;
+    double cpuMin = 0.0, cpuMax = 0.0, cpuAvg = 0.0, cpuLast = 0.0;
+    double memoryMin = 0.0, memoryMax = 0.0, memoryAvg = 0.0, memoryLast = 0.0;
+};
+
+/// Fixed-width rollup buckets with min/max/avg/last per column.
+/// Samples are folded into the open bucket as they arrive; a sample from a later
+/// bucket seals it into a CompressedSeries of `blockCount` blocks, which reuses its
+/// oldest block when full. Sealed values are stored as fixed-point integers (CPU to
+/// 0.01 %, memory to 1/16 MB) and encoded as deltas, so an unchanged column costs one
+/// bit per bucket and a small step about a byte.
+///
+/// Single writer: one thread calls Add(). ForEachInRange() may run on any thread at
+/// the same time without blocking it: sealed blocks are copied lock-free (see
+/// CompressedSeries) and the open bucket is read through a seqlock.
+class RollupTier {
+public:
+    using CpuCodec = HistoryRing::CpuCodec;
+    using MemoryCodec = FixedPointCodec<16, uint32_t>;
+
+    RollupTier(int64_t widthMs, size_t blockCount);
+
+    /// Sealed buckets in external storage, resumed from the region; the open bucket starts empty.
+    RollupTier(int64_t widthMs, size_t blockCount, const CompressedSeries::Region& region);
+
+    void Add(int64_t timestampMs, double cpuPercent, double memoryMB);
+
+    int64_t WidthMs() const { return widthMs_; }
+    const CompressedSeries& Sealed() const { return sealed_; }
+
+    /// Start of the first bucket not sealed yet, INT64_MIN when none is. Writer thread only.
+    int64_t UnsealedFromMs() const
+    {
+        int64_t latestMs = sealed_.LatestTimestampMs();
+        return latestMs == std::numeric_limits<int64_t>::min() ? latestMs : latestMs + widthMs_;
+    }
+    size_t MemoryBytes() const { return sealed_.MemoryBytes(); }
+
+    /// Call fn(const RollupPoint&) for every bucket oldest first, ending with the open one.
+    template <typename Fn>
+    void ForEach(Fn&& fn) const
+    {
+        ForEachInRange(std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(), fn);
+    }
+
+    /// As ForEach(), for the buckets overlapping [fromMs, toMs]. Safe to call from any thread.
+    template <typename Fn>
+    void ForEachInRange(int64_t fromMs, int64_t toMs, Fn&& fn) const
+    {
+        // Read the open bucket first: if it is sealed meanwhile, the sealed copy is
+        // found below and replaces it, so a bucket is never lost or reported twice
+        Accumulator open = CopyOpen();
+
+        // A bucket starting up to one width before fromMs still overlaps it
+        int64_t firstStartMs = fromMs > std::numeric_limits<int64_t>::min() + widthMs_ ? fromMs - widthMs_ + 1 : fromMs;
+        int64_t sealedMs = std::numeric_limits<int64_t>::min();
+        sealed_.ForEachInRange(firstStartMs, toMs, [&](int64_t startMs, std::span<const uint32_t> v) {
+            auto cpu = [&](size_t c) { return CpuCodec::Decode(static_cast<CpuCodec::Stored>(v[c])); };
+            auto memory = [&](size_t c) { return MemoryCodec::Decode(v[c]); };
+            fn(RollupPoint{ startMs, cpu(0), cpu(1), cpu(2), cpu(3), memory(4), memory(5), memory(6), memory(7) });
+            sealedMs = startMs;
+        });
+        if (open.count > 0 && open.startMs > sealedMs && open.startMs >= firstStartMs && open.startMs <= toMs)
+            fn(open.Point());
+    }
+
+private:
+    static constexpr size_t Columns = 8;
+
+    struct Accumulator {
+        int64_t startMs = 0;
+        uint32_t count = 0;
+        double cpuMin = 0.0, cpuMax = 0.0, cpuSum = 0.0, cpuLast = 0.0;
+        double memoryMin = 0.0, memoryMax = 0.0, memorySum = 0.0, memoryLast = 0.0;
+
+        RollupPoint Point() const
+        {
+            return { startMs, cpuMin, cpuMax, cpuSum / count, cpuLast,
+                     memoryMin, memoryMax, memorySum / count, memoryLast };
+        }
+    };
+
+    static constexpr double Accumulator::*AccumulatorFields[] = {
+        &Accumulator::cpuMin, &Accumulator::cpuMax, &Accumulator::cpuSum, &Accumulator::cpuLast,
+        &Accumulator::memoryMin, &Accumulator::memoryMax, &Accumulator::memorySum, &Accumulator::memoryLast,
+    };
+
+    void Seal();
+    void PublishOpen(const Accumulator& value);
+    Accumulator CopyOpen() const;
+
+    int64_t widthMs_;
+    CompressedSeries sealed_;
+    Accumulator open_;                          // stored with atomic_ref inside the seqlock
+    std::atomic<uint64_t> openVersion_{ 0 };    // odd while the writer is changing open_
+};
+
+/// One service's history at three resolutions: raw samples for 2 hours,
+/// 10-second rollups for 24 hours and 1-minute rollups for 30 days.
+/// Every tier, and the sliding-window quantile sketches, is updated incrementally by
+/// Push(), from a single writer thread. CopyRaw(), CopyRollup(), GetStats() and
+/// GetMeans() may run on other threads meanwhile and never hold a lock the writer
+/// waits on for longer than one sketch merge (see RollupTier and SlidingQuantiles).
+class ServiceHistory {
+public:
+    enum class Resolution { Raw, TenSeconds, OneMinute };
+
+    static constexpr size_t RawCapacity = 7200;                 // 2 h at 1 s
+    static constexpr int64_t RawSpanMs = 2LL * 3600 * 1000;
+    static constexpr int64_t TenSecondsMs = 10'000;
+    static constexpr size_t TenSecondBuckets = 24 * 360;        // 24 h
+    static constexpr int64_t OneMinuteMs = 60'000;
+    static constexpr size_t OneMinuteBuckets = 30 * 24 * 60;    // 30 d
+
+    /// Rollup block counts: the spans above at the 7-9 bytes per bucket HistoryBench
+    /// measures for a mostly idle service. A busy one (about 16 bytes per bucket)
+    /// keeps about 12 h and 18 days.
+    static constexpr size_t TenSecondBlocks = 64;               // 66 KiB
+    static constexpr size_t OneMinuteBlocks = 400;              // 412 KiB
+
+    /// Memory per service, against the 50 MB target for 300 services. The raw ring and
+    /// the rollup blocks take StorageBytes, fixed up front; with a HistoryFile they are
+    /// in its mapping, file-backed pages the system can drop and reread, not private
+    /// memory. The sketches and the object itself are on the heap, within
+    /// HeapBudgetBytes: under 20 MB for 300 services (HistoryBench checks both).
+    /// Without a history file StorageBytes is on the heap too, and the target holds
+    /// for about 75 services.
+    static constexpr size_t StorageBytes = RawCapacity * HistoryRing::SampleBytes
+        + (TenSecondBlocks + OneMinuteBlocks) * CompressedSeries::BlockBytes;  // 576 KiB
+    static constexpr size_t HeapBudgetBytes = 64 * 1024;
+
+    /// Sliding windows with quantile stats. The 1 min window moves in 10 s steps,
+    /// the others in 1 min steps.
+    enum class StatsWindow { OneMinute, FifteenMinutes, OneHour };
+
+    struct Quantiles {
+        uint64_t count = 0;
+        double p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+    };
+
+    /// External storage for every tier (see HistoryFile).
+    struct Region {
+        HistoryRing::Region raw;
+        CompressedSeries::Region tenSeconds;
+        CompressedSeries::Region oneMinute;
+    };
+
+    ServiceHistory();
+
+    /// Tiers in external storage, resumed from what the region holds. Only the raw
+    /// samples a rollup tier had not sealed are folded into it again, and the last hour
+    /// into the sketches, so restoring costs a few thousand samples at most.
+    explicit ServiceHistory(const Region& region);
+
+    void Push(int64_t timestampMs, double cpuPercent, double memoryMB);
+
+    /// Thread-safe copies of one time range of a tier.
+    void CopyRaw(int64_t fromMs, int64_t toMs, HistoryRing::Samples& out) const { raw_.CopyRange(fromMs, toMs, out); }
+    void CopyRollup(Resolution resolution, int64_t fromMs, int64_t toMs, std::vector<RollupPoint>& out) const;
+
+    /// CPU and memory quantiles over the window ending at nowMs, without scanning samples. Thread-safe.
+    void GetStats(StatsWindow window, int64_t nowMs, Quantiles& cpu, Quantiles& memory) const;
+
+    /// CPU and memory means over the same windows, from running sums. Thread-safe.
+    void GetMeans(StatsWindow window, int64_t nowMs, double& cpu, double& memory) const;
+
+    /// Length of a stats window.
+    static int64_t WindowMs(StatsWindow window);
+
+    /// Writer thread only.
+    const HistoryRing& Raw() const { return raw_; }
+    const RollupTier& Rollup(Resolution resolution) const
+    {
+        return resolution == Resolution::TenSeconds ? tenSeconds_ : oneMinute_;
+    }
+
+    /// Finest resolution whose retention covers a query reaching `rangeMs` back from now.
+    static Resolution SelectResolution(int64_t rangeMs);
+
+private:
+    void AddSummaries(int64_t timestampMs, double cpuPercent, double memoryMB);
+
+    HistoryRing raw_;
+    RollupTier tenSeconds_;
+    RollupTier oneMinute_;
+    SlidingQuantiles cpuFine_;          // 10 s steps, 1 min window
+    SlidingQuantiles cpuCoarse_;        // 1 min steps, 15 min and 1 h windows
+    SlidingQuantiles memoryFine_;
+    SlidingQuantiles memoryCoarse_;
+};
+
+} // namespace smc
@@ -0,0 +1,162 @@
+#include "ServiceRegistry.h"
+
+#include <mutex>
+
+namespace smc {
+
+namespace {
+
+void AppendUtf8(std::string& out, uint32_t cp)
+{
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+void AppendWide(std::wstring& out, uint32_t cp)
+{
+    if constexpr (sizeof(wchar_t) == 2) {
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            out += static_cast<wchar_t>(0xD800 | (cp >> 10));
+            out += static_cast<wchar_t>(0xDC00 | (cp & 0x3FF));
+            return;
+        }
+    }
+    out += static_cast<wchar_t>(cp);
+}
+
+// Conversions run once per name, when it is interned. Invalid sequences become U+FFFD.
+std::string ToUtf8(const std::wstring& wide)
+{
+    std::string out;
+    out.reserve(wide.size());
+    for (size_t i = 0; i < wide.size(); ++i) {
+        uint32_t cp = static_cast<uint32_t>(wide[i]);
+        if constexpr (sizeof(wchar_t) == 2) {
+            if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < wide.size()) {
+                uint32_t low = static_cast<uint32_t>(wide[i + 1]);
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    ++i;
+                }
+            }
+        }
+        if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)
+            cp = 0xFFFD;
+        AppendUtf8(out, cp);
+    }
+    return out;
+}
+
+std::wstring ToWide(const std::string& utf8)
+{
+    std::wstring out;
+    out.reserve(utf8.size());
+    for (size_t i = 0; i < utf8.size();) {
+        auto lead = static_cast<unsigned char>(utf8[i]);
+        if (lead < 0x80) {
+            out += static_cast<wchar_t>(lead);
+            ++i;
+            continue;
+        }
+
+        // C0, C1 and F5-FF never start a sequence; each length has a smallest valid code point
+        size_t length = lead >= 0xC2 && lead <= 0xDF ? 2 : (lead >> 4) == 0xE ? 3 : lead >= 0xF0 && lead <= 0xF4 ? 4 : 0;
+        uint32_t minimum = length == 2 ? 0x80 : length == 3 ? 0x800 : 0x10000;
+
+        uint32_t cp = lead & (0x7F >> length);
+        size_t used = 1;
+        while (used < length && i + used < utf8.size() &&
+               (static_cast<unsigned char>(utf8[i + used]) & 0xC0) == 0x80) {
+            cp = (cp << 6) | (static_cast<unsigned char>(utf8[i + used]) & 0x3F);
+            ++used;
+        }
+
+        // A truncated sequence is replaced once, together with the continuation bytes it had
+        if (length == 0 || used < length || cp < minimum || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+            cp = 0xFFFD;
+        AppendWide(out, cp);
+        i += used;
+    }
+    return out;
+}
+
+} // anonymous namespace
+
+ServiceId ServiceRegistry::Intern(const std::wstring& name)
+{
+    {
+        std::shared_lock lock(mutex_);
+        auto it = ids_.find(name);
+        if (it != ids_.end())
+            return it->second;
+    }
+
+    std::unique_lock lock(mutex_);
+    return InternLocked(name, ToUtf8(name));
+}
+
+ServiceId ServiceRegistry::InternUtf8(const std::string& name)
+{
+    auto wide = ToWide(name);
+    std::unique_lock lock(mutex_);
+    return InternLocked(std::move(wide), name);
+}
+
+ServiceId ServiceRegistry::InternLocked(std::wstring wide, std::string utf8)
+{
+    auto it = ids_.find(wide);
+    if (it != ids_.end())
+        return it->second;
+
+    auto id = static_cast<ServiceId>(entries_.size());
+    ids_.emplace(wide, id);
+    entries_.push_back(std::make_unique<Entry>(Entry{ std::move(wide), std::move(utf8) }));
+    return id;
+}
+
+bool ServiceRegistry::Find(const std::wstring& name, ServiceId& id) const
+{
+    std::shared_lock lock(mutex_);
+    auto it = ids_.find(name);
+    if (it == ids_.end())
+        return false;
+    id = it->second;
+    return true;
+}
+
+const std::wstring& ServiceRegistry::WideName(ServiceId id) const
+{
+    std::shared_lock lock(mutex_);
+    return entries_[id]->wide;
+}
+
+const std::string& ServiceRegistry::Utf8Name(ServiceId id) const
+{
+    std::shared_lock lock(mutex_);
+    return entries_[id]->utf8;
+}
+
+size_t ServiceRegistry::Size() const
+{
+    std::shared_lock lock(mutex_);
+    return entries_.size();
+}
+
+} // namespace smc
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace smc {
+
+/// Dense index of an interned service name; valid for the registry's lifetime.
+using ServiceId = uint32_t;
+
+/// Interns service names into dense IDs assigned from 0 upwards, keeping both the
+/// UTF-16 and UTF-8 forms. Per-service state can then live in plain vectors indexed
+/// by ID, and the tick path never converts or hashes a name once it is known.
+/// Names are never removed; the set of services on a host is small and stable.
+/// Thread-safe. Name references stay valid for the registry's lifetime.
+class ServiceRegistry {
+public:
+    /// ID for a name, interning it on first sight.
+    ServiceId Intern(const std::wstring& name);
+    ServiceId InternUtf8(const std::string& name);
+
+    /// ID of an already interned name. Returns false if it is unknown.
+    bool Find(const std::wstring& name, ServiceId& id) const;
+
+    const std::wstring& WideName(ServiceId id) const;
+    const std::string& Utf8Name(ServiceId id) const;
+
+    /// One past the highest ID handed out.
+    size_t Size() const;
+
+private:
+    struct Entry {
+        std::wstring wide;
+        std::string utf8;
+    };
+
+    ServiceId InternLocked(std::wstring wide, std::string utf8);
+
+    mutable std::shared_mutex mutex_;
+    std::vector<std::unique_ptr<Entry>> entries_;   // stable addresses
+    std::unordered_map<std::wstring, ServiceId> ids_;
+};
+
+} // namespace smc
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ServiceTypes.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace smc {
+
+/// Receives service state changes from a ServiceStateSource.
+/// Calls may arrive on any thread; implementations synchronize internally.
+class ServiceStateSink {
+public:
+    virtual ~ServiceStateSink() = default;
+
+    /// Replace the whole table (initial load or resync after lost notifications).
+    virtual void OnServiceTable(const std::vector<ServiceEntry>& services) = 0;
+
+    /// A service was created or changed state / PID.
+    virtual void OnServiceChanged(const ServiceEntry& service) = 0;
+
+    /// A service was deleted.
+    virtual void OnServiceRemoved(const std::wstring& serviceName) = 0;
+};
+
+/// Pluggable producer of service state change notifications.
+class ServiceStateSource {
+public:
+    virtual ~ServiceStateSource() = default;
+
+    /// Begin delivering notifications to `sink`. Returns false if notifications are unavailable.
+    virtual bool Start(ServiceStateSink& sink) = 0;
+
+    /// Stop delivering notifications. No sink calls are made after this returns.
+    virtual void Stop() = 0;
+};
+
+/// Source driven by explicit Publish/Remove calls instead of the OS.
+/// Used on platforms without SCM notifications and by test stubs.
+class ManualServiceStateSource : public ServiceStateSource {
+public:
+    bool Start(ServiceStateSink& sink) override
+    {
+        std::lock_guard lock(mutex_);
+        sink_ = &sink;
+        return true;
+    }
+
+    void Stop() override
+    {
+        std::lock_guard lock(mutex_);
+        sink_ = nullptr;
+    }
+
+    void PublishTable(const std::vector<ServiceEntry>& services)
+    {
+        std::lock_guard lock(mutex_);
+        if (sink_) sink_->OnServiceTable(services);
+    }
+
+    void Publish(const ServiceEntry& service)
+    {
+        std::lock_guard lock(mutex_);
+        if (sink_) sink_->OnServiceChanged(service);
+    }
+
+    void Remove(const std::wstring& serviceName)
+    {
+        std::lock_guard lock(mutex_);
+        if (sink_) sink_->OnServiceRemoved(serviceName);
+    }
+
+private:
+    std::mutex mutex_;
+    ServiceStateSink* sink_ = nullptr;
+};
+
+/// Create the notification source for the platform this binary was built for.
+std::unique_ptr<ServiceStateSource> CreateServiceStateSource();
+
+} // namespace smc
@@ -0,0 +1,93 @@
+#include "ServiceStateTracker.h"
+#include "Logger.h"
+
+#include <mutex>
+
+namespace smc {
+
+#ifndef _WIN32
+std::unique_ptr<ServiceStateSource> CreateServiceStateSource()
+{
+    // No service manager notifications off Windows; the table is fed explicitly.
+    return std::make_unique<ManualServiceStateSource>();
+}
+#endif
+
+ServiceStateTracker::ServiceStateTracker(std::unique_ptr<ServiceStateSource> source)
+    : source_(std::move(source))
+{
+}
+
+ServiceStateTracker::~ServiceStateTracker()
+{
+    Stop();
+}
+
+bool ServiceStateTracker::Start()
+{
+    if (live_.load())
+        return true;
+
+    if (!source_ || !source_->Start(*this)) {
+        Logger::Error(L"Service state notifications unavailable, falling back to polling");
+        return false;
+    }
+
+    live_ = true;
+    return true;
+}
+
+void ServiceStateTracker::Stop()
+{
+    if (!live_.exchange(false))
+        return;
+    source_->Stop();
+}
+
+bool ServiceStateTracker::Lookup(const std::wstring& serviceName, ServiceEntry& entry) const
+{
+    std::shared_lock lock(mutex_);
+    auto it = table_.find(serviceName);
+    if (it == table_.end())
+        return false;
+    entry = it->second;
+    return true;
+}
+
+void ServiceStateTracker::CopyActive(std::vector<ServiceEntry>& services) const
+{
+    services.clear();
+    std::shared_lock lock(mutex_);
+    for (const auto& [name, entry] : table_) {
+        if (entry.processId != 0)
+            services.push_back(entry);
+    }
+}
+
+void ServiceStateTracker::OnServiceTable(const std::vector<ServiceEntry>& services)
+{
+    std::unique_lock lock(mutex_);
+    table_.clear();
+    for (const auto& entry : services)
+        table_[entry.name] = entry;
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+void ServiceStateTracker::OnServiceChanged(const ServiceEntry& service)
+{
+    std::unique_lock lock(mutex_);
+    auto& entry = table_[service.name];
+    if (entry.state != service.state && !entry.name.empty())
+        Logger::Info(L"Service " + service.name + L" -> " + ServiceStateName(service.state));
+    entry = service;
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+void ServiceStateTracker::OnServiceRemoved(const std::wstring& serviceName)
+{
+    std::unique_lock lock(mutex_);
+    if (table_.erase(serviceName) > 0)
+        version_.fetch_add(1, std::memory_order_release);
+}
+
+} // namespace smc
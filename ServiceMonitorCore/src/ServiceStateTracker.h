@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ServiceStateSource.h"
+
+#include <atomic>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace smc {
+
+/// In-memory service state table kept current by a ServiceStateSource.
+/// Reads never touch the SCM; Version() changes whenever the table does, so
+/// consumers can skip re-copying it on ticks where nothing happened.
+class ServiceStateTracker : public ServiceStateSink {
+public:
+    explicit ServiceStateTracker(std::unique_ptr<ServiceStateSource> source = CreateServiceStateSource());
+    ~ServiceStateTracker() override;
+
+    ServiceStateTracker(const ServiceStateTracker&) = delete;
+    ServiceStateTracker& operator=(const ServiceStateTracker&) = delete;
+
+    /// Start the notification source. Returns false if it is unavailable,
+    /// in which case callers should keep polling the SCM themselves.
+    bool Start();
+    void Stop();
+
+    /// True while the source is delivering notifications.
+    bool IsLive() const { return live_.load(); }
+
+    /// Incremented on every table change.
+    uint64_t Version() const { return version_.load(std::memory_order_acquire); }
+
+    /// Look up one service. Returns false if it is not in the table.
+    bool Lookup(const std::wstring& serviceName, ServiceEntry& entry) const;
+
+    /// Copy every service with a live process into `services` (cleared first).
+    void CopyActive(std::vector<ServiceEntry>& services) const;
+
+    // ServiceStateSink
+    void OnServiceTable(const std::vector<ServiceEntry>& services) override;
+    void OnServiceChanged(const ServiceEntry& service) override;
+    void OnServiceRemoved(const std::wstring& serviceName) override;
+
+private:
+    std::unique_ptr<ServiceStateSource> source_;
+    std::atomic<bool> live_{ false };
+    std::atomic<uint64_t> version_{ 0 };
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::wstring, ServiceEntry> table_;
+};
+
+} // namespace smc
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ProcessBackend.h"
+
+#include <cstdint>
+#include <string>
+
+namespace smc {
+
+/// Service state. Values match the Win32 SERVICE_* state constants.
+enum class ServiceState : uint32_t {
+    Unknown = 0,
+    Stopped = 1,
+    StartPending = 2,
+    StopPending = 3,
+    Running = 4,
+    ContinuePending = 5,
+    PausePending = 6,
+    Paused = 7,
+};
+
+/// Status string used in IPC responses.
+inline const wchar_t* ServiceStateName(ServiceState state)
+{
+    switch (state) {
+    case ServiceState::Running:      return L"Running";
+    case ServiceState::Stopped:      return L"Stopped";
+    case ServiceState::Paused:       return L"Paused";
+    case ServiceState::StartPending: return L"StartPending";
+    case ServiceState::StopPending:  return L"StopPending";
+    default:                         return L"Unknown";
+    }
+}
+
+/// One row of the service table: name, hosting process and current state.
+struct ServiceEntry {
+    std::wstring name;
+    ProcessId processId = 0;
+    ServiceState state = ServiceState::Unknown;
+};
+
+} // namespace smc
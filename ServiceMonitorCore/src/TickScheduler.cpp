@@ -0,0 +1,150 @@
+#include "TickScheduler.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace smc {
+
+namespace {
+
+int64_t ToMicroseconds(TickScheduler::Clock::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+int64_t ToMilliseconds(std::chrono::nanoseconds d)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+}
+
+// Wall clock disagreement with the steady clock beyond which the wall clock is taken as stepped
+constexpr int64_t MaxClockSlewMs = 1000;
+
+} // anonymous namespace
+
+TickScheduler::TickScheduler(std::chrono::milliseconds period)
+    : period_(period)
+    , epoch_(Clock::now())
+    , wallAnchorMs_(ToMilliseconds(std::chrono::system_clock::now().time_since_epoch()))
+{
+}
+
+bool TickScheduler::WaitNext()
+{
+    std::unique_lock lock(mutex_);
+
+    if (!started_) {
+        started_ = true;
+        deadline_ = Clock::now();
+        if (stopping_)
+            return false;
+        RecordStart(Clock::duration::zero());
+        return true;
+    }
+
+    for (;;) {
+        if (stopping_)
+            return false;
+
+        auto next = deadline_ + period_;
+        auto now = Clock::now();
+        if (now >= next) {
+            // Stay on the original grid: run once for the latest passed deadline
+            auto missed = (now - next) / period_;
+            deadline_ = next + missed * period_;
+            stats_.skippedTicks += static_cast<uint64_t>(missed);
+            RecordStart(now - deadline_);
+            return true;
+        }
+
+        periodChanged_ = false;
+        cv_.wait_until(lock, next, [this] { return stopping_ || periodChanged_; });
+    }
+}
+
+void TickScheduler::EndTick()
+{
+    std::lock_guard lock(mutex_);
+    auto elapsed = Clock::now() - deadline_;
+    stats_.lastDurationUs = ToMicroseconds(elapsed) - stats_.lastJitterUs;
+    if (elapsed > period_)
+        ++stats_.overruns;
+}
+
+void TickScheduler::SetPeriod(std::chrono::milliseconds period)
+{
+    {
+        std::lock_guard lock(mutex_);
+        period_ = period;
+        periodChanged_ = true;
+    }
+    cv_.notify_all();
+}
+
+std::chrono::milliseconds TickScheduler::Period() const
+{
+    std::lock_guard lock(mutex_);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(period_);
+}
+
+void TickScheduler::Stop()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+}
+
+void TickScheduler::Reset()
+{
+    std::lock_guard lock(mutex_);
+    started_ = false;
+    stopping_ = false;
+    jitterSumUs_ = 0;
+    stats_ = {};
+}
+
+TickScheduler::Stats TickScheduler::GetStats() const
+{
+    std::lock_guard lock(mutex_);
+    return stats_;
+}
+
+TickScheduler::TickStamp TickScheduler::CurrentTick() const
+{
+    std::lock_guard lock(mutex_);
+    return current_;
+}
+
+void TickScheduler::RecordStart(Clock::duration jitter)
+{
+    int64_t us = ToMicroseconds(jitter);
+    ++stats_.ticks;
+    stats_.lastJitterUs = us;
+    stats_.maxJitterUs = std::max(stats_.maxJitterUs, us);
+    jitterSumUs_ += us;
+    stats_.meanJitterUs = static_cast<double>(jitterSumUs_) / static_cast<double>(stats_.ticks);
+    StampTick();
+}
+
+void TickScheduler::StampTick()
+{
+    // Stamps sit on the deadline grid, so regular ticks give regular timestamps
+    int64_t monotonicMs = ToMilliseconds(deadline_ - epoch_);
+    int64_t systemMs = ToMilliseconds(std::chrono::system_clock::now().time_since_epoch());
+    int64_t wallMs = wallAnchorMs_ + monotonicMs;
+
+    // Follow a stepped wall clock, but never back past the previous tick: history
+    // timestamp columns must stay ordered for range queries
+    if (std::abs(systemMs - wallMs) > MaxClockSlewMs && systemMs > current_.wallMs) {
+        wallAnchorMs_ = systemMs - monotonicMs;
+        wallMs = systemMs;
+    }
+
+    ++current_.sequence;
+    current_.monotonicMs = monotonicMs;
+    current_.wallMs = std::max(wallMs, current_.wallMs);
+}
+
+} // namespace smc
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace smc {
+
+/// Fires monitoring ticks on absolute steady-clock deadlines (start + n * period),
+/// so collection time does not accumulate into drift. A tick that is late by one
+/// or more whole periods runs once at the latest missed deadline and the rest are
+/// counted as skipped, never run back to back. Stop() wakes a waiting thread at once.
+class TickScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Time of one tick, taken once when it starts and shared by every sample it produces.
+    struct TickStamp {
+        uint64_t sequence = 0;          // ticks since construction, from 1
+        int64_t monotonicMs = 0;        // deadline on the steady clock, since construction
+        int64_t wallMs = 0;             // Unix ms, advanced by the steady clock so it never steps back
+    };
+
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t skippedTicks = 0;      // deadlines passed over because a tick ran long
+        uint64_t overruns = 0;          // ticks whose work outlasted the period
+        int64_t lastJitterUs = 0;       // start delay after the deadline
+        int64_t maxJitterUs = 0;
+        double meanJitterUs = 0.0;
+        int64_t lastDurationUs = 0;     // time from tick start to EndTick()
+    };
+
+    explicit TickScheduler(std::chrono::milliseconds period);
+
+    /// Block until the next deadline. Returns false once Stop() has been called.
+    /// The first call after construction or Reset() fires immediately.
+    bool WaitNext();
+
+    /// Mark the end of the current tick's work.
+    void EndTick();
+
+    /// Change the period; takes effect relative to the current tick's deadline. Thread-safe.
+    void SetPeriod(std::chrono::milliseconds period);
+    std::chrono::milliseconds Period() const;
+
+    /// Wake WaitNext() and make it return false. Thread-safe.
+    void Stop();
+
+    /// Clear the stop flag and statistics so the scheduler can run again.
+    void Reset();
+
+    Stats GetStats() const;
+
+    /// Stamp of the tick most recently started by WaitNext(). Thread-safe.
+    TickStamp CurrentTick() const;
+
+private:
+    void RecordStart(Clock::duration jitter);
+    void StampTick();
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    Clock::duration period_;
+    Clock::time_point deadline_;        // deadline of the current tick
+    Clock::time_point epoch_;
+    int64_t wallAnchorMs_ = 0;          // wall clock at epoch_, re-anchored on a clock step
+    TickStamp current_;
+    bool started_ = false;
+    bool stopping_ = false;
+    bool periodChanged_ = false;
+    int64_t jitterSumUs_ = 0;
+    Stats stats_;
+};
+
+} // namespace smc
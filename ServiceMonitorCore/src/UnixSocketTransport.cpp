@@ -0,0 +1,371 @@
+#include "UnixSocketTransport.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace smc {
+
+namespace {
+
+// epoll tags that are not connections
+constexpr uint64_t PostKey = 0;
+constexpr uint64_t ListenKey = 1;
+
+constexpr int ReadyBatch = 16;
+
+// Per I/O thread state. A write that finished at once completes on the same thread's
+// next Wait() rather than through the posted queue, like FILE_SKIP_COMPLETION_PORT_ON_SUCCESS.
+// Events are one-shot, so the rest of an epoll_wait() batch belongs to this thread too.
+struct LocalState {
+    const UnixSocketTransport* owner = nullptr;     // set while the thread is inside a Wait() cycle
+    bool pending = false;
+    IpcCompletion completion;
+    epoll_event ready[ReadyBatch];
+    int readyCount = 0;
+    int readyNext = 0;
+};
+thread_local LocalState local;
+
+bool Retryable(int error)
+{
+    return error == EAGAIN || error == EWOULDBLOCK || error == EINTR;
+}
+
+// A SEQPACKET send fails with EMSGSIZE unless the whole message fits in the send buffer,
+// and the default (net.core.wmem_default) is about 208 KiB, so ask for MaxMessageBytes;
+// the kernel doubles the value for its bookkeeping. Past net.core.wmem_max only
+// SO_SNDBUFFORCE, which needs CAP_NET_ADMIN, is honoured; SO_SNDBUF is clamped there.
+// Returns the buffer size in effect.
+int RaiseSendBuffer(int fd)
+{
+    int bytes = static_cast<int>(IpcTransport::MaxMessageBytes);
+    if (::setsockopt(fd, SOL_SOCKET, SO_SNDBUFFORCE, &bytes, sizeof(bytes)) != 0)
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes));
+    int effective = 0;
+    socklen_t length = sizeof(effective);
+    ::getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &effective, &length);
+    return effective;
+}
+
+} // anonymous namespace
+
+struct UnixSocketTransport::Connection : IpcConnection {
+    ~Connection() override
+    {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    int fd = -1;
+    bool registered = false;                // fd is in the epoll set
+};
+
+std::unique_ptr<IpcTransport> CreateIpcTransport()
+{
+    return std::make_unique<UnixSocketTransport>();
+}
+
+UnixSocketTransport::~UnixSocketTransport()
+{
+    Close();
+}
+
+bool UnixSocketTransport::Listen(const std::wstring& name)
+{
+    path_ = std::filesystem::path(name).string();
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path_.empty() || path_.size() >= sizeof(address.sun_path)) {
+        Logger::Error(L"Invalid socket path: " + name);
+        return false;
+    }
+    std::memcpy(address.sun_path, path_.c_str(), path_.size() + 1);
+
+    auto fail = [this](const wchar_t* what) {
+        Logger::Error(std::wstring(what) + L" failed: " + std::to_wstring(errno));
+        Close();
+        return false;
+    };
+
+    listenFd_ = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0)
+        return fail(L"socket");
+    ::unlink(path_.c_str());    // stale socket from an earlier run
+    if (::bind(listenFd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        return fail(L"bind");
+    if (::listen(listenFd_, SOMAXCONN) != 0)
+        return fail(L"listen");
+
+    // Accepted sockets do not inherit the listener's buffer size, but it shows what they will get
+    sendBufferBytes_ = RaiseSendBuffer(listenFd_);
+    if (static_cast<size_t>(sendBufferBytes_) < MaxMessageBytes)
+        Logger::Info(L"Socket send buffer limited to " + std::to_wstring(sendBufferBytes_)
+                      + L" bytes (net.core.wmem_max); longer responses drop the client");
+
+    // Semaphore mode: one count per posted completion, so each one wakes a waiter
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    postFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC | EFD_SEMAPHORE);
+    if (epollFd_ < 0 || postFd_ < 0)
+        return fail(L"epoll_create1/eventfd");
+
+    epoll_event postEvent{};
+    postEvent.events = EPOLLIN;
+    postEvent.data.u64 = PostKey;
+    epoll_event listenEvent{};
+    listenEvent.events = EPOLLIN | EPOLLONESHOT;
+    listenEvent.data.u64 = ListenKey;
+    if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, postFd_, &postEvent) != 0 ||
+        ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &listenEvent) != 0)
+        return fail(L"epoll_ctl");
+    return true;
+}
+
+void UnixSocketTransport::Close()
+{
+    for (int* fd : { &listenFd_, &epollFd_, &postFd_ }) {
+        if (*fd >= 0)
+            ::close(*fd);
+        *fd = -1;
+    }
+    if (!path_.empty()) {
+        ::unlink(path_.c_str());
+        path_.clear();
+    }
+    accepting_.clear();
+    posted_.clear();
+    postedCount_ = 0;
+}
+
+std::unique_ptr<IpcConnection> UnixSocketTransport::CreateConnection()
+{
+    auto conn = std::make_unique<Connection>();
+    conn->buffer.resize(MessageBufferBytes);
+    return conn;
+}
+
+bool UnixSocketTransport::Accept(IpcConnection& conn)
+{
+    // The listener is one-shot and re-armed while anyone is waiting for a client
+    std::lock_guard lock(acceptMutex_);
+    accepting_.push_back(static_cast<Connection*>(&conn));
+    if (accepting_.size() == 1 && !ArmListener()) {
+        accepting_.pop_back();
+        return false;
+    }
+    return true;
+}
+
+bool UnixSocketTransport::Read(IpcConnection& conn)
+{
+    return Arm(static_cast<Connection&>(conn), EPOLLIN);
+}
+
+bool UnixSocketTransport::Write(IpcConnection& conn)
+{
+    auto& c = static_cast<Connection&>(conn);
+
+    // A whole message or nothing is sent; a full socket buffer waits for EPOLLOUT
+    const std::string& message = c.Outgoing();
+    ssize_t sent = ::send(c.fd, message.data(), message.size(), MSG_NOSIGNAL);
+    if (sent >= 0) {
+        IpcCompletion completion{ &c, true, static_cast<size_t>(sent) };
+        if (local.owner == this && !local.pending) {
+            local.pending = true;
+            local.completion = completion;
+        }
+        else {
+            Post(completion);
+        }
+        return true;
+    }
+    if (Retryable(errno))
+        return Arm(c, EPOLLOUT);
+    if (errno == EMSGSIZE)
+        Logger::Error(L"Message exceeds the " + std::to_wstring(sendBufferBytes_) + L" byte socket buffer: "
+                      + std::to_wstring(message.size()) + L" bytes");
+    return false;
+}
+
+void UnixSocketTransport::Cancel(IpcConnection& conn)
+{
+    auto& c = static_cast<Connection&>(conn);
+    {
+        std::lock_guard lock(acceptMutex_);
+        auto it = std::find(accepting_.begin(), accepting_.end(), &c);
+        if (it != accepting_.end()) {
+            accepting_.erase(it);
+            Post({ &c, false, 0 });
+            return;
+        }
+    }
+
+    // A pending read or write sees the hang-up and completes with an error
+    if (c.fd >= 0)
+        ::shutdown(c.fd, SHUT_RDWR);
+}
+
+void UnixSocketTransport::Disconnect(IpcConnection& conn)
+{
+    // Closing the descriptor also removes it from the epoll set
+    auto& c = static_cast<Connection&>(conn);
+    if (c.fd >= 0)
+        ::close(c.fd);
+    c.fd = -1;
+    c.registered = false;
+
+    // Drop the room a long request needed rather than keep it in the pool
+    if (c.buffer.size() > MessageBufferBytes) {
+        c.buffer.resize(MessageBufferBytes);
+        c.buffer.shrink_to_fit();
+    }
+}
+
+bool UnixSocketTransport::Wait(IpcCompletion& completion)
+{
+    if (local.owner != this) {
+        local.owner = this;
+        local.pending = false;
+        local.readyCount = local.readyNext = 0;
+    }
+    if (local.pending) {
+        local.pending = false;
+        completion = local.completion;
+        return true;
+    }
+
+    for (;;) {
+        while (local.readyNext < local.readyCount) {
+            const epoll_event& event = local.ready[local.readyNext++];
+            if (event.data.u64 == PostKey) {
+                uint64_t value = 0;
+                [[maybe_unused]] auto bytes = ::read(postFd_, &value, sizeof(value));
+            }
+            else if (event.data.u64 == ListenKey) {
+                AcceptReady();
+            }
+            else if (Complete(*static_cast<Connection*>(event.data.ptr), completion)) {
+                return true;
+            }
+        }
+
+        if (postedCount_.load(std::memory_order_acquire) > 0) {
+            std::lock_guard lock(postMutex_);
+            if (!posted_.empty()) {
+                postedCount_.fetch_sub(1, std::memory_order_relaxed);
+                completion = posted_.front();
+                posted_.pop_front();
+                if (!completion.connection)
+                    local.owner = nullptr;
+                return completion.connection != nullptr;
+            }
+        }
+
+        int count = ::epoll_wait(epollFd_, local.ready, ReadyBatch, -1);
+        if (count < 0 && errno != EINTR) {
+            Logger::Error(L"epoll_wait failed: " + std::to_wstring(errno));
+            local.owner = nullptr;
+            return false;
+        }
+        local.readyCount = count > 0 ? count : 0;
+        local.readyNext = 0;
+    }
+}
+
+void UnixSocketTransport::Wake(size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        Post({});
+}
+
+bool UnixSocketTransport::Arm(Connection& conn, uint32_t events)
+{
+    // Once armed, another thread may own the connection, so nothing is touched afterwards
+    epoll_event event{};
+    event.events = events | EPOLLONESHOT;
+    event.data.ptr = &conn;
+    bool registered = conn.registered;
+    conn.registered = true;
+    if (::epoll_ctl(epollFd_, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, conn.fd, &event) != 0) {
+        conn.registered = registered;
+        return false;
+    }
+    return true;
+}
+
+bool UnixSocketTransport::ArmListener()
+{
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = ListenKey;
+    return ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, listenFd_, &event) == 0;
+}
+
+void UnixSocketTransport::AcceptReady()
+{
+    std::lock_guard lock(acceptMutex_);
+    while (!accepting_.empty()) {
+        int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (!Retryable(errno))
+                Logger::Error(L"accept failed: " + std::to_wstring(errno));
+            break;
+        }
+
+        RaiseSendBuffer(fd);
+        Connection* conn = accepting_.front();
+        accepting_.pop_front();
+        conn->fd = fd;
+        conn->registered = false;
+        Post({ conn, true, 0 });
+    }
+    if (!accepting_.empty())
+        ArmListener();
+}
+
+bool UnixSocketTransport::Complete(Connection& conn, IpcCompletion& completion)
+{
+    bool reading = conn.op == IpcConnection::Op::Read;
+    if (reading) {
+        // A SEQPACKET message cannot be taken in pieces: peek its length and make room for all of it
+        ssize_t length = ::recv(conn.fd, nullptr, 0, MSG_PEEK | MSG_TRUNC);
+        if (length > static_cast<ssize_t>(conn.buffer.size()) && static_cast<size_t>(length) <= MaxMessageBytes)
+            conn.buffer.resize(static_cast<size_t>(length));
+    }
+    ssize_t bytes = reading ? ::recv(conn.fd, conn.buffer.data(), conn.buffer.size(), MSG_TRUNC)
+                            : ::send(conn.fd, conn.Outgoing().data(), conn.Outgoing().size(), MSG_NOSIGNAL);
+    if (bytes < 0 && Retryable(errno) && Arm(conn, reading ? EPOLLIN : EPOLLOUT))
+        return false;
+
+    if (reading && bytes > static_cast<ssize_t>(conn.buffer.size())) {
+        Logger::Error(L"Request exceeds the size limit: " + std::to_wstring(bytes) + L" bytes");
+        completion = { &conn, false, 0 };
+        return true;
+    }
+
+    completion = { &conn, bytes > 0 || (!reading && bytes == 0), bytes > 0 ? static_cast<size_t>(bytes) : 0 };
+    return true;
+}
+
+void UnixSocketTransport::Post(const IpcCompletion& completion)
+{
+    {
+        std::lock_guard lock(postMutex_);
+        posted_.push_back(completion);
+        postedCount_.fetch_add(1, std::memory_order_release);
+    }
+    uint64_t one = 1;
+    [[maybe_unused]] auto bytes = ::write(postFd_, &one, sizeof(one));
+}
+
+} // namespace smc
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "IpcTransport.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace smc {
+
+/// IpcTransport over an AF_UNIX SOCK_SEQPACKET socket at a filesystem path. Each send is
+/// delivered as one message, as with a message-mode Named Pipe. A message cannot be read in
+/// pieces, so a read grows the buffer to the message's length (up to MaxMessageBytes)
+/// and never completes with `more`. A message is also sent whole, so the send buffer of
+/// each accepted socket is raised to hold MaxMessageBytes; without CAP_NET_ADMIN the
+/// kernel caps it at twice net.core.wmem_max (about 416 KiB by default), and a longer
+/// response fails and drops the client. Long histories are sent in parts well below that.
+/// Completions are emulated on epoll: reads and writes arm a one-shot registration and
+/// run the syscall when it fires, so exactly one thread owns a ready connection.
+/// Writes that succeed at once, accepts and cancellations go through a posted queue
+/// that wakes Wait() via an eventfd, like PostQueuedCompletionStatus.
+class UnixSocketTransport : public IpcTransport {
+public:
+    ~UnixSocketTransport() override;
+
+    bool Listen(const std::wstring& name) override;
+    void Close() override;
+
+    std::unique_ptr<IpcConnection> CreateConnection() override;
+
+    bool Accept(IpcConnection& conn) override;
+    bool Read(IpcConnection& conn) override;
+    bool Write(IpcConnection& conn) override;
+    void Cancel(IpcConnection& conn) override;
+    void Disconnect(IpcConnection& conn) override;
+
+    bool Wait(IpcCompletion& completion) override;
+    void Wake(size_t count) override;
+
+private:
+    struct Connection;
+
+    bool Arm(Connection& conn, uint32_t events);
+    bool ArmListener();
+    void AcceptReady();
+    bool Complete(Connection& conn, IpcCompletion& completion);
+    void Post(const IpcCompletion& completion);
+
+    std::string path_;
+    int listenFd_ = -1;
+    int epollFd_ = -1;
+    int postFd_ = -1;                       // eventfd, readable while posted_ may be non-empty
+    int sendBufferBytes_ = 0;               // SO_SNDBUF of accepted sockets, as the kernel set it
+
+    std::mutex acceptMutex_;
+    std::deque<Connection*> accepting_;     // waiting for a client, oldest first
+
+    std::mutex postMutex_;
+    std::deque<IpcCompletion> posted_;      // connection == nullptr wakes one Wait()
+    std::atomic<size_t> postedCount_{ 0 };  // lets Wait() skip the lock when nothing is posted
+};
+
+} // namespace smc
@@ -0,0 +1,137 @@
+#include "Win32ProcessBackend.h"
+
+#include <memory>
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <Psapi.h>
+#include <winternl.h>
+
+#include <cstring>
+
+#pragma comment(lib, "psapi.lib")
+#pragma comment(lib, "ntdll.lib")
+
+namespace smc {
+
+namespace {
+
+uint64_t FileTimeToUInt64(const FILETIME& ft)
+{
+    ULARGE_INTEGER value{};
+    value.LowPart = ft.dwLowDateTime;
+    value.HighPart = ft.dwHighDateTime;
+    return value.QuadPart;
+}
+
+uint64_t LargeIntegerAt(const BYTE* base, size_t offset)
+{
+    LARGE_INTEGER value{};
+    std::memcpy(&value, base + offset, sizeof(value));
+    return static_cast<uint64_t>(value.QuadPart);
+}
+
+// winternl.h hides these SYSTEM_PROCESS_INFORMATION fields inside Reserved1[48]:
+// WorkingSetPrivateSize, HardFaultCount, NumberOfThreadsHighWatermark, CycleTime,
+// then CreateTime, UserTime, KernelTime.
+constexpr size_t CreateTimeOffset = 24;
+constexpr size_t UserTimeOffset = 32;
+constexpr size_t KernelTimeOffset = 40;
+
+constexpr NTSTATUS StatusInfoLengthMismatch = static_cast<NTSTATUS>(0xC0000004L);
+
+} // anonymous namespace
+
+std::unique_ptr<ProcessBackend> CreateProcessBackend()
+{
+    return std::make_unique<Win32ProcessBackend>();
+}
+
+Win32ProcessBackend::Win32ProcessBackend()
+{
+    SYSTEM_INFO sysInfo{};
+    ::GetSystemInfo(&sysInfo);
+    numProcessors_ = static_cast<int>(sysInfo.dwNumberOfProcessors);
+    if (numProcessors_ < 1) numProcessors_ = 1;
+}
+
+bool Win32ProcessBackend::Sample(ProcessId processId, ProcessSample& sample)
+{
+    HANDLE hProcess = ::OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId);
+    if (!hProcess)
+        return false;
+
+    // RAII handle wrapper
+    auto closer = std::unique_ptr<void, decltype(&::CloseHandle)>(hProcess, ::CloseHandle);
+
+    sample = {};
+    sample.processId = processId;
+
+    FILETIME nowFt{};
+    ::GetSystemTimeAsFileTime(&nowFt);
+    sample.sampleTime = FileTimeToUInt64(nowFt);
+
+    FILETIME createTime{}, exitTime{}, kernelTime{}, userTime{};
+    if (::GetProcessTimes(hProcess, &createTime, &exitTime, &kernelTime, &userTime)) {
+        sample.creationTime = FileTimeToUInt64(createTime);
+        sample.cpuTime = FileTimeToUInt64(kernelTime) + FileTimeToUInt64(userTime);
+    }
+
+    PROCESS_MEMORY_COUNTERS_EX pmc{};
+    pmc.cb = sizeof(pmc);
+    if (::GetProcessMemoryInfo(hProcess, reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&pmc), sizeof(pmc))) {
+        sample.workingSetBytes = pmc.WorkingSetSize;
+    }
+
+    return true;
+}
+
+bool Win32ProcessBackend::SampleAll(std::vector<ProcessSample>& samples)
+{
+    samples.clear();
+
+    if (snapshotBuffer_.empty())
+        snapshotBuffer_.resize(256 * 1024);
+
+    NTSTATUS status = 0;
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        ULONG returnLength = 0;
+        status = ::NtQuerySystemInformation(SystemProcessInformation, snapshotBuffer_.data(),
+            static_cast<ULONG>(snapshotBuffer_.size()), &returnLength);
+        if (status != StatusInfoLengthMismatch)
+            break;
+        // Leave headroom for processes created between the two calls
+        snapshotBuffer_.resize(static_cast<size_t>(returnLength) + 64 * 1024);
+    }
+
+    if (!NT_SUCCESS(status))
+        return false;
+
+    FILETIME nowFt{};
+    ::GetSystemTimeAsFileTime(&nowFt);
+    uint64_t now = FileTimeToUInt64(nowFt);
+
+    const BYTE* cursor = snapshotBuffer_.data();
+    for (;;) {
+        auto* info = reinterpret_cast<const SYSTEM_PROCESS_INFORMATION*>(cursor);
+        auto pid = static_cast<ProcessId>(reinterpret_cast<ULONG_PTR>(info->UniqueProcessId));
+
+        if (pid != 0) {
+            ProcessSample& sample = samples.emplace_back();
+            sample.processId = pid;
+            sample.sampleTime = now;
+            sample.creationTime = LargeIntegerAt(info->Reserved1, CreateTimeOffset);
+            sample.cpuTime = LargeIntegerAt(info->Reserved1, UserTimeOffset) +
+                             LargeIntegerAt(info->Reserved1, KernelTimeOffset);
+            sample.workingSetBytes = info->WorkingSetSize;
+        }
+
+        if (info->NextEntryOffset == 0)
+            break;
+        cursor += info->NextEntryOffset;
+    }
+
+    return true;
+}
+
+} // namespace smc
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "ProcessBackend.h"
+
+namespace smc {
+
+/// ProcessBackend using OpenProcess / GetProcessTimes / GetProcessMemoryInfo.
+/// Times are FILETIME-based (100 ns since 1601).
+class Win32ProcessBackend : public ProcessBackend {
+public:
+    Win32ProcessBackend();
+
+    int ProcessorCount() const override { return numProcessors_; }
+    bool Sample(ProcessId processId, ProcessSample& sample) override;
+
+    /// One NtQuerySystemInformation(SystemProcessInformation) call for all processes.
+    bool SampleAll(std::vector<ProcessSample>& samples) override;
+
+private:
+    int numProcessors_ = 1;
+    std::vector<unsigned char> snapshotBuffer_;
+};
+
+} // namespace smc
@@ -0,0 +1,255 @@
+#include "WireFormat.h"
+
+#include <bit>
+#include <cstring>
+
+namespace smc::wire {
+
+static_assert(std::endian::native == std::endian::little, "frames are written in host byte order");
+
+namespace {
+
+uint64_t ZigZag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Deltas wrap rather than overflow, so any input round-trips
+int64_t Delta(int64_t value, int64_t previous)
+{
+    return static_cast<int64_t>(static_cast<uint64_t>(value) - static_cast<uint64_t>(previous));
+}
+
+} // anonymous namespace
+
+FrameWriter::FrameWriter(std::string& out, FrameKind kind)
+    : out_(out)
+{
+    out_.assign(FrameHeaderBytes, '\0');
+    out_[0] = static_cast<char>(FrameMagic);
+    out_[1] = static_cast<char>(kind);
+}
+
+FrameWriter::FrameWriter(std::string& out)
+    : out_(out)
+{
+    out_.clear();
+}
+
+void FrameWriter::Varint(uint64_t value)
+{
+    while (value >= 0x80) {
+        out_.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out_.push_back(static_cast<char>(value));
+}
+
+void FrameWriter::SignedVarint(int64_t value)
+{
+    Varint(ZigZag(value));
+}
+
+void FrameWriter::String(std::string_view value)
+{
+    Varint(value.size());
+    out_.append(value);
+}
+
+void FrameWriter::Float(double value)
+{
+    float f = static_cast<float>(value);
+    out_.append(reinterpret_cast<const char*>(&f), sizeof(f));
+}
+
+void FrameWriter::Floats(std::span<const double> values)
+{
+    size_t offset = out_.size();
+    out_.resize(offset + values.size() * sizeof(float));
+    char* dst = out_.data() + offset;
+    for (double value : values) {
+        float f = static_cast<float>(value);
+        std::memcpy(dst, &f, sizeof(f));
+        dst += sizeof(f);
+    }
+}
+
+void FrameWriter::Floats(std::span<const RollupPoint> points, double RollupPoint::*column)
+{
+    size_t offset = out_.size();
+    out_.resize(offset + points.size() * sizeof(float));
+    char* dst = out_.data() + offset;
+    for (const auto& point : points) {
+        float f = static_cast<float>(point.*column);
+        std::memcpy(dst, &f, sizeof(f));
+        dst += sizeof(f);
+    }
+}
+
+void FrameWriter::Timestamps(std::span<const int64_t> timestampsMs)
+{
+    int64_t previous = 0;
+    for (int64_t t : timestampsMs) {
+        SignedVarint(Delta(t, previous));
+        previous = t;
+    }
+}
+
+void FrameWriter::Timestamps(std::span<const RollupPoint> points)
+{
+    int64_t previous = 0;
+    for (const auto& point : points) {
+        SignedVarint(Delta(point.startMs, previous));
+        previous = point.startMs;
+    }
+}
+
+void FrameWriter::Names(std::span<const ServiceId> ids, const ServiceRegistry& registry, std::vector<bool>& sent)
+{
+    size_t count = 0;
+    for (ServiceId id : ids)
+        count += id >= sent.size() || !sent[id];
+    Varint(count);
+    for (ServiceId id : ids) {
+        if (id < sent.size() && sent[id]) continue;
+        if (id >= sent.size())
+            sent.resize(id + 1, false);
+        sent[id] = true;
+        Varint(id);
+        String(registry.Utf8Name(id));
+    }
+}
+
+void FrameWriter::RawSeries(ServiceId id, const HistoryRing::Samples& samples)
+{
+    RawSeries(id, samples, 0, samples.Size());
+}
+
+void FrameWriter::RawSeries(ServiceId id, const HistoryRing::Samples& samples, size_t offset, size_t count)
+{
+    Varint(id);
+    Varint(count);
+    Timestamps(std::span(samples.timestampsMs).subspan(offset, count));
+    Floats(std::span(samples.cpu).subspan(offset, count));
+    Floats(std::span(samples.memory).subspan(offset, count));
+}
+
+void FrameWriter::RollupSeries(ServiceId id, std::span<const RollupPoint> points)
+{
+    Varint(id);
+    Varint(points.size());
+    Timestamps(points);
+    for (auto column : { &RollupPoint::cpuAvg, &RollupPoint::memoryAvg,
+                         &RollupPoint::cpuMin, &RollupPoint::cpuMax, &RollupPoint::cpuLast,
+                         &RollupPoint::memoryMin, &RollupPoint::memoryMax, &RollupPoint::memoryLast })
+        Floats(points, column);
+}
+
+void FrameWriter::Finish()
+{
+    auto length = static_cast<uint32_t>(out_.size() - FrameHeaderBytes);
+    std::memcpy(out_.data() + 2, &length, sizeof(length));
+}
+
+FrameReader::FrameReader(std::string_view frame)
+{
+    if (frame.size() < FrameHeaderBytes || !IsFrame(frame))
+        return;
+    uint32_t length = 0;
+    std::memcpy(&length, frame.data() + 2, sizeof(length));
+    if (frame.size() - FrameHeaderBytes != length)
+        return;
+    kind_ = static_cast<FrameKind>(static_cast<uint8_t>(frame[1]));
+    body_ = frame.substr(FrameHeaderBytes);
+    ok_ = true;
+}
+
+uint8_t FrameReader::Byte()
+{
+    if (!ok_ || pos_ >= body_.size()) {
+        ok_ = false;
+        return 0;
+    }
+    return static_cast<uint8_t>(body_[pos_++]);
+}
+
+uint64_t FrameReader::Varint()
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte = Byte();
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return ok_ ? value : 0;
+    }
+    ok_ = false;
+    return 0;
+}
+
+int64_t FrameReader::SignedVarint()
+{
+    return UnZigZag(Varint());
+}
+
+std::string FrameReader::String()
+{
+    uint64_t size = Varint();
+    if (!ok_ || size > body_.size() - pos_) {
+        ok_ = false;
+        return {};
+    }
+    std::string value(body_.substr(pos_, size));
+    pos_ += size;
+    return value;
+}
+
+void FrameReader::Floats(size_t count, std::vector<double>& out)
+{
+    out.clear();
+    if (!ok_ || count > (body_.size() - pos_) / sizeof(float)) {
+        ok_ = false;
+        return;
+    }
+    out.resize(count);
+    const char* src = body_.data() + pos_;
+    for (size_t i = 0; i < count; ++i, src += sizeof(float)) {
+        float f;
+        std::memcpy(&f, src, sizeof(f));
+        out[i] = f;
+    }
+    pos_ += count * sizeof(float);
+}
+
+void FrameReader::Timestamps(size_t count, std::vector<int64_t>& out)
+{
+    out.clear();
+    // Each delta takes at least one byte
+    if (!ok_ || count > body_.size() - pos_) {
+        ok_ = false;
+        return;
+    }
+    out.reserve(count);
+    int64_t previous = 0;
+    for (size_t i = 0; i < count && ok_; ++i) {
+        previous = static_cast<int64_t>(static_cast<uint64_t>(previous) + static_cast<uint64_t>(SignedVarint()));
+        out.push_back(previous);
+    }
+    if (!ok_)
+        out.clear();
+}
+
+std::string JsonFrame(std::string_view jsonText)
+{
+    std::string frame;
+    FrameWriter writer(frame, FrameKind::Json);
+    frame.append(jsonText);
+    writer.Finish();
+    return frame;
+}
+
+} // namespace smc::wire
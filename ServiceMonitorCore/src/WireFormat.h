@@ -0,0 +1,134 @@
+#pragma once
+
+#include "HistoryRing.h"
+#include "ServiceHistory.h"
+#include "ServiceRegistry.h"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace smc {
+
+/// Binary IPC framing, the opt-in alternative to JSON text responses. A client asks for
+/// it with HELLO; the connection then gets every response as one frame:
+///
+///   magic u8 (0xB7) | kind u8 | length u32 | body (length bytes)
+///
+/// Fixed-width values are little-endian. In the body, integers are LEB128 varints (signed
+/// ones zigzag-encoded), strings are a varint length and UTF-8 bytes, and series are raw
+/// float32 arrays. Services are referred to by varint registry ID; the body's name table
+/// holds only the names not yet sent on the connection.
+///
+///   names     = count, count x (id, string)
+///   AllStatus = names, count, count x (id, f32 cpu, f32 memoryMB)
+///   History   = u8 resolution (0 raw, 1 10 s, 2 1 min), string cursor, u8 behind, names, count, count x series
+///               (every service; with sinceCursor, those with nothing new have n = 0)
+///   series    = id, n, n x timestamp (first absolute, then deltas), f32[n] cpu, f32[n] memoryMB
+///               and for rollups f32[n] cpuMin, cpuMax, cpuLast, memoryMBMin, memoryMBMax, memoryMBLast
+///
+/// A long history goes out as HistoryPart frames ending with one History frame, each a
+/// whole History body. A series cut at a frame boundary continues in the next frame
+/// under the same ID; the client appends it.
+///
+/// Values and their order match the JSON responses of the same commands.
+namespace wire {
+
+constexpr uint8_t FrameMagic = 0xB7;        // never the first byte of a JSON text
+constexpr size_t FrameHeaderBytes = 6;
+constexpr int ProtocolVersion = 1;
+
+enum class FrameKind : uint8_t {
+    Json = 1,           // body is the JSON response of a command without a binary schema
+    AllStatus = 2,
+    History = 3,
+    HistoryPart = 4,    // History body; more frames of the same response follow
+};
+
+/// Appends one frame to a string. Finish() fills in the length.
+class FrameWriter {
+public:
+    /// Start a frame of `kind`, replacing the contents of `out`.
+    FrameWriter(std::string& out, FrameKind kind);
+
+    /// Write body fields only, replacing the contents of `out`, for a frame to Append() later.
+    explicit FrameWriter(std::string& out);
+
+    void Byte(uint8_t value) { out_.push_back(static_cast<char>(value)); }
+    void Varint(uint64_t value);
+    void SignedVarint(int64_t value);
+    void String(std::string_view value);
+
+    /// Bytes already encoded, such as a body fragment.
+    void Append(std::string_view bytes) { out_.append(bytes); }
+
+    /// `value` as float32.
+    void Float(double value);
+
+    /// `values` as float32.
+    void Floats(std::span<const double> values);
+
+    /// One column of `points` as float32.
+    void Floats(std::span<const RollupPoint> points, double RollupPoint::*column);
+
+    /// The first value, then each one's delta to the previous.
+    void Timestamps(std::span<const int64_t> timestampsMs);
+    void Timestamps(std::span<const RollupPoint> points);
+
+    /// Name table entries for the IDs in `ids` not yet marked in `sent`, which is updated.
+    void Names(std::span<const ServiceId> ids, const ServiceRegistry& registry, std::vector<bool>& sent);
+
+    void RawSeries(ServiceId id, const HistoryRing::Samples& samples);
+
+    /// Samples [offset, offset + count) only.
+    void RawSeries(ServiceId id, const HistoryRing::Samples& samples, size_t offset, size_t count);
+    void RollupSeries(ServiceId id, std::span<const RollupPoint> points);
+
+    /// Write the body length into the header.
+    void Finish();
+
+private:
+    std::string& out_;
+};
+
+/// Reads the fields of a frame body in order. A read past the end, or a malformed
+/// value, returns zero and clears Ok() for good.
+class FrameReader {
+public:
+    /// Check the header of `frame`. Ok() is false if it is not one whole frame.
+    explicit FrameReader(std::string_view frame);
+
+    bool Ok() const { return ok_; }
+    FrameKind Kind() const { return kind_; }
+
+    /// Rest of the body, unread.
+    std::string_view Remaining() const { return body_.substr(pos_); }
+
+    uint8_t Byte();
+    uint64_t Varint();
+    int64_t SignedVarint();
+    std::string String();
+    void Floats(size_t count, std::vector<double>& out);
+    void Timestamps(size_t count, std::vector<int64_t>& out);
+
+private:
+    std::string_view body_;
+    size_t pos_ = 0;
+    FrameKind kind_ = FrameKind::Json;
+    bool ok_ = false;
+};
+
+/// True if `message` starts like a frame rather than JSON text.
+inline bool IsFrame(std::string_view message)
+{
+    return !message.empty() && static_cast<uint8_t>(message[0]) == FrameMagic;
+}
+
+/// `jsonText` as a Json frame.
+std::string JsonFrame(std::string_view jsonText);
+
+} // namespace wire
+
+} // namespace smc
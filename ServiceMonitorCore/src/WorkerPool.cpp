@@ -0,0 +1,95 @@
+#include "WorkerPool.h"
+
+namespace smc {
+
+WorkerPool::WorkerPool(size_t threadCount)
+    : participants_(threadCount + 1)
+{
+    shards_ = std::make_unique<Shard[]>(participants_);
+    threads_.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+        threads_.emplace_back(&WorkerPool::WorkerLoop, this, i + 1);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    startCv_.notify_all();
+    for (auto& thread : threads_)
+        thread.join();
+}
+
+void WorkerPool::ParallelFor(size_t count, const std::function<void(size_t)>& fn)
+{
+    if (count == 0)
+        return;
+
+    // Contiguous shards, the first `count % participants_` one item larger
+    size_t base = count / participants_;
+    size_t extra = count % participants_;
+    size_t begin = 0;
+    for (size_t p = 0; p < participants_; ++p) {
+        size_t size = base + (p < extra ? 1 : 0);
+        shards_[p].next.store(begin, std::memory_order_relaxed);
+        shards_[p].end = begin + size;
+        begin += size;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        job_ = &fn;
+        active_ = threads_.size();
+        ++batch_;
+    }
+    startCv_.notify_all();
+
+    // The calling thread is participant 0
+    RunShards(0);
+
+    std::unique_lock lock(mutex_);
+    doneCv_.wait(lock, [this] { return active_ == 0; });
+    job_ = nullptr;
+}
+
+void WorkerPool::WorkerLoop(size_t participant)
+{
+    uint64_t seenBatch = 0;
+    for (;;) {
+        {
+            std::unique_lock lock(mutex_);
+            startCv_.wait(lock, [&] { return stopping_ || batch_ != seenBatch; });
+            if (stopping_)
+                return;
+            seenBatch = batch_;
+        }
+
+        RunShards(participant);
+
+        {
+            std::lock_guard lock(mutex_);
+            if (--active_ == 0)
+                doneCv_.notify_one();
+        }
+    }
+}
+
+void WorkerPool::RunShards(size_t participant)
+{
+    const auto& fn = *job_;
+
+    // Own shard first, then steal from the others in ring order
+    for (size_t offset = 0; offset < participants_; ++offset) {
+        Shard& shard = shards_[(participant + offset) % participants_];
+        for (;;) {
+            size_t index = shard.next.fetch_add(1, std::memory_order_relaxed);
+            if (index >= shard.end)
+                break;
+            fn(index);
+        }
+    }
+}
+
+} // namespace smc
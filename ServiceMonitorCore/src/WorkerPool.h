@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace smc {
+
+/// Small fixed-size thread pool for data-parallel batches.
+/// ParallelFor splits the index range into one shard per participant (the
+/// workers plus the calling thread). Each participant drains its own shard and
+/// then steals remaining indices from the others, so a shard stuck behind a
+/// slow item does not hold up the batch.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threadCount);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t ThreadCount() const { return threads_.size(); }
+
+    /// Run fn(i) for every i in [0, count) and block until all calls have returned.
+    /// Not reentrant: one batch at a time.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<size_t> next{ 0 };
+        size_t end = 0;
+    };
+
+    void WorkerLoop(size_t participant);
+    void RunShards(size_t participant);
+
+    std::vector<std::thread> threads_;
+    std::unique_ptr<Shard[]> shards_;
+    size_t participants_ = 1;
+
+    std::mutex mutex_;
+    std::condition_variable startCv_;
+    std::condition_variable doneCv_;
+    const std::function<void(size_t)>* job_ = nullptr;
+    uint64_t batch_ = 0;
+    size_t active_ = 0;
+    bool stopping_ = false;
+};
+
+} // namespace smc
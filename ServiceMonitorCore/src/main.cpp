@@ -28,7 +28,7 @@ static int RunConsoleMode(const std::filesystem::path& logDir)
     smc::Logger::Init(logDir);
     std::wcout << L"[Console Mode] ServiceMonitorCore started. Press Ctrl+C to stop.\n";
 
-    smc::MonitorService service;
+    smc::MonitorService service(logDir / L"history.dat");
     service.RunConsole();
 
     std::wcout << L"[Console Mode] Pipe server listening on \\\\.\\pipe\\ServiceMonitorPipe\n";
@@ -61,7 +61,7 @@ int WINAPI wWinMain(
     // Normal Windows Service mode
     smc::Logger::Init(logDir);
 
-    smc::MonitorService service;
+    smc::MonitorService service(logDir / L"history.dat");
     bool result = smc::ServiceBase::Run(service);
 
     // Fallback to console mode if not launched as a service
@@ -12,6 +12,15 @@ namespace WinServiceController.Models
 
         [JsonPropertyName("intervalMs")]
         public int IntervalMs { get; set; }
+
+        /// <summary>Number of entries for GET_TOP; 0 uses the server default.</summary>
+        [JsonPropertyName("n")]
+        public int Count { get; set; }
+
+        /// <summary>SUBSCRIBE topic: "all-status", "services" or "alerts".</summary>
+        [JsonPropertyName("topic")]
+        [JsonIgnore(Condition = JsonIgnoreCondition.WhenWritingNull)]
+        public string? Topic { get; set; }
     }
 
     public class IpcResponse
@@ -33,6 +42,13 @@ namespace WinServiceController.Models
 
         [JsonPropertyName("services")]
         public List<ServiceSnapshot>? Services { get; set; }
+
+        /// <summary>
+        /// More parts of the same response follow (long GET_HISTORY responses).
+        /// SendCommandAsync reads them all and merges a service split across parts into one entry.
+        /// </summary>
+        [JsonPropertyName("more")]
+        public bool More { get; set; }
     }
 
     public class ServiceSnapshot
@@ -11,5 +11,12 @@ namespace WinServiceController.Services
         void Disconnect();
 
         Task<IpcResponse?> SendCommandAsync(IpcRequest request, CancellationToken cancellationToken = default);
+
+        /// <summary>
+        /// Send a SUBSCRIBE request on a connection of its own and pass each pushed message to
+        /// <paramref name="onPush"/> until the engine disconnects or the token is cancelled.
+        /// Returns false if the subscription could not be set up.
+        /// </summary>
+        Task<bool> RunSubscriptionAsync(IpcRequest request, Action<IpcResponse> onPush, CancellationToken cancellationToken = default);
     }
 }
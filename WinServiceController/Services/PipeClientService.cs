@@ -68,21 +68,19 @@ namespace WinServiceController.Services
                 await _pipeStream!.WriteAsync(requestBytes, cancellationToken);
                 await _pipeStream.FlushAsync(cancellationToken);
 
-                // Read full message (may span multiple reads in message mode)
-                using var ms = new System.IO.MemoryStream();
-                var buffer = new byte[BufferSize];
-                do
-                {
-                    var bytesRead = await _pipeStream.ReadAsync(buffer, cancellationToken);
-                    if (bytesRead == 0) break;
-                    ms.Write(buffer, 0, bytesRead);
-                } while (!_pipeStream.IsMessageComplete);
-
-                if (ms.Length == 0)
-                    return null;
+                var response = await ReadResponseAsync(_pipeStream, cancellationToken);
 
-                var responseJson = Encoding.UTF8.GetString(ms.GetBuffer(), 0, (int)ms.Length);
-                return JsonSerializer.Deserialize<IpcResponse>(responseJson);
+                // A long response arrives in parts; each but the last is marked "more"
+                while (response is { More: true })
+                {
+                    var part = await ReadResponseAsync(_pipeStream, cancellationToken);
+                    if (part == null)
+                        return null;
+                    if (part.Services != null)
+                        MergeServices(response.Services ??= new(), part.Services);
+                    response.More = part.More;
+                }
+                return response;
             }
             catch (Exception ex)
             {
@@ -96,6 +94,88 @@ namespace WinServiceController.Services
             }
         }
 
+        public async Task<bool> RunSubscriptionAsync(IpcRequest request, Action<IpcResponse> onPush, CancellationToken cancellationToken = default)
+        {
+            try
+            {
+                // A subscribed connection only receives pushes, so it gets a pipe of its own
+                using var pipe = new NamedPipeClientStream(".", PipeName, PipeDirection.InOut, PipeOptions.Asynchronous);
+                await pipe.ConnectAsync(ConnectTimeoutMs, cancellationToken);
+                pipe.ReadMode = PipeTransmissionMode.Message;
+
+                var requestBytes = Encoding.UTF8.GetBytes(JsonSerializer.Serialize(request));
+                await pipe.WriteAsync(requestBytes, cancellationToken);
+                await pipe.FlushAsync(cancellationToken);
+
+                var reply = await ReadResponseAsync(pipe, cancellationToken);
+                if (reply is null || reply.Error is not null)
+                {
+                    Log.Debug("Subscription refused: {Error}", reply?.Error);
+                    return false;
+                }
+
+                // Runs until the engine goes away or the caller cancels
+                while (await ReadResponseAsync(pipe, cancellationToken) is { } push)
+                    onPush(push);
+                return true;
+            }
+            catch (OperationCanceledException)
+            {
+                return true;
+            }
+            catch (TimeoutException)
+            {
+                Log.Debug("Monitoring engine pipe connection timed out");
+                return false;
+            }
+            catch (Exception ex)
+            {
+                Log.Error(ex, "IPC subscription error");
+                return false;
+            }
+        }
+
+        /// <summary>
+        /// Append one part's services. A series cut at a part boundary continues in the next
+        /// part under the same name, so that entry is folded into the last one instead of
+        /// becoming a second snapshot of the service.
+        /// </summary>
+        private static void MergeServices(List<ServiceSnapshot> services, List<ServiceSnapshot> part)
+        {
+            foreach (var service in part)
+            {
+                if (services.Count > 0 && services[^1].Name == service.Name)
+                {
+                    // The continuation holds the later values
+                    services[^1].Cpu = service.Cpu;
+                    services[^1].MemoryMB = service.MemoryMB;
+                }
+                else
+                {
+                    services.Add(service);
+                }
+            }
+        }
+
+        private static async Task<IpcResponse?> ReadResponseAsync(PipeStream pipe, CancellationToken cancellationToken)
+        {
+            // Read full message (may span multiple reads in message mode)
+            using var ms = new System.IO.MemoryStream();
+            var buffer = new byte[BufferSize];
+            do
+            {
+                var bytesRead = await pipe.ReadAsync(buffer, cancellationToken);
+                if (bytesRead == 0) break;
+                ms.Write(buffer, 0, bytesRead);
+            } while (!pipe.IsMessageComplete);
+
+            if (ms.Length == 0)
+                return null;
+
+            var responseJson = Encoding.UTF8.GetString(ms.GetBuffer(), 0, (int)ms.Length);
+            return JsonSerializer.Deserialize<IpcResponse>(responseJson);
+        }
+
         public void Dispose()
         {
             Disconnect();
@@ -38,6 +38,8 @@ namespace WinServiceController.ViewModels.Pages
         private readonly IUserSettingsService _settingsService;
         private bool _isInitialized;
         private DispatcherTimer? _pollTimer;
+        private CancellationTokenSource? _pushCts;
+        private bool _pushActive;
         private int _tickCount;
         private bool _hasAutoSelectedTop10;
 
@@ -336,14 +338,28 @@ namespace WinServiceController.ViewModels.Pages
             ApplyChartSettings();
             await RefreshServicesAsync();
             _pollTimer?.Start();
+
+            StopStatusSubscription();
+            _pushCts = new CancellationTokenSource();
+            _ = RunStatusSubscriptionAsync(_pushCts.Token);
         }
 
         public Task OnNavigatedFromAsync()
         {
             _pollTimer?.Stop();
+            StopStatusSubscription();
             return Task.CompletedTask;
         }
 
+        private void StopStatusSubscription()
+        {
+            // Cancelled before it is disposed, so the subscription loop still sees its token
+            // as cancelled and exits
+            _pushCts?.Cancel();
+            _pushCts?.Dispose();
+            _pushCts = null;
+        }
+
         private void ApplyChartSettings()
         {
             var s = _settingsService.Settings;
@@ -444,12 +460,22 @@ namespace WinServiceController.ViewModels.Pages
                 if (!_hasAutoSelectedTop10)
                 {
                     _hasAutoSelectedTop10 = true;
-                    var top = newList
-                        .Where(s => s.Status == ServiceControllerStatus.Running)
-                        .OrderByDescending(s => s.CpuUsage + s.MemoryMB)
-                        .Take(TopNDefault)
-                        .Select(s => s.ServiceName)
-                        .ToHashSet(StringComparer.OrdinalIgnoreCase);
+
+                    // The monitor ranks its latest samples (CPU + memory) itself; fall back to
+                    // ranking the values read above when it has none yet
+                    var topResponse = await _pipeClient.SendCommandAsync(new IpcRequest
+                    {
+                        Command = "GET_TOP",
+                        Count = TopNDefault
+                    });
+                    var top = topResponse?.Services is { Count: > 0 } ranked
+                        ? ranked.Select(s => s.Name).ToHashSet(StringComparer.OrdinalIgnoreCase)
+                        : newList
+                            .Where(s => s.Status == ServiceControllerStatus.Running)
+                            .OrderByDescending(s => s.CpuUsage + s.MemoryMB)
+                            .Take(TopNDefault)
+                            .Select(s => s.ServiceName)
+                            .ToHashSet(StringComparer.OrdinalIgnoreCase);
 
                     foreach (var info in newList)
                         info.ShowInChart = top.Contains(info.ServiceName);
@@ -685,10 +711,49 @@ namespace WinServiceController.ViewModels.Pages
 
         // --- Multi-service polling ---
 
+        // The engine pushes GET_ALL_STATUS values once per tick; the poll timer only fills in
+        // while no push stream is up (engine stopped or restarting)
+        private async Task RunStatusSubscriptionAsync(CancellationToken token)
+        {
+            while (!token.IsCancellationRequested)
+            {
+                await _pipeClient.RunSubscriptionAsync(new IpcRequest
+                {
+                    Command = "SUBSCRIBE",
+                    Topic = "all-status",
+                    IntervalMs = 1000
+                }, OnStatusPushed, token);
+                _pushActive = false;
+
+                try
+                {
+                    await Task.Delay(TimeSpan.FromSeconds(3), token);
+                }
+                catch (OperationCanceledException)
+                {
+                    break;
+                }
+            }
+        }
+
+        private void OnStatusPushed(IpcResponse push)
+        {
+            _pushActive = true;
+            var window = ChartWindowSeconds();
+            foreach (var snap in push.Services ?? [])
+                AddDataPoint(snap.Name, snap.Cpu, snap.MemoryMB, window);
+            AdvanceChartWindow(window);
+        }
+
+        private int ChartWindowSeconds() => _settingsService.Settings.ChartWindowSeconds > 0
+            ? _settingsService.Settings.ChartWindowSeconds : 7200;
+
         private async Task PollAllServicesAsync()
         {
-            var window = _settingsService.Settings.ChartWindowSeconds > 0
-                ? _settingsService.Settings.ChartWindowSeconds : 7200;
+            if (_pushActive)
+                return;
+
+            var window = ChartWindowSeconds();
 
             var response = await _pipeClient.SendCommandAsync(new IpcRequest
             {
@@ -715,6 +780,11 @@ namespace WinServiceController.ViewModels.Pages
                 }
             }
 
+            AdvanceChartWindow(window);
+        }
+
+        private void AdvanceChartWindow(int window)
+        {
             _tickCount++;
             if (_tickCount > window)
             {